@@ -0,0 +1,190 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "analyze.h"
+#include "chessv2.h"
+#include "time.h"
+
+#define ANALYZE_LINE 512
+#define ANALYZE_FEN 128
+#define ANALYZE_SLOTS_PER_THREAD 64
+#define MAX_ANALYZE_THREADS 256
+
+enum { SLOT_FREE = 0, SLOT_READY, SLOT_DONE };
+
+typedef struct {
+    char line[ANALYZE_LINE];
+    char fen[ANALYZE_FEN];
+    size_t epd_len;
+    bool ok;
+    int state;
+    ChessInfo info;
+} Slot;
+
+typedef struct {
+    const AnalyzeOptions *opt;
+    Slot *slots;
+    uint64_t ring;
+    uint64_t read_seq;
+    uint64_t claim_seq;
+    bool eof;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cv;
+    pthread_cond_t done_cv;
+} Pipeline;
+
+static bool all_digits(const char *s, size_t len) {
+    if (len == 0) return false;
+    for (size_t i = 0; i < len; ++i) {
+        if (!isdigit((unsigned char)s[i])) return false;
+    }
+    return true;
+}
+
+static bool extract_fen(Slot *s) {
+    const char *p = s->line;
+    char *dst = s->fen;
+    size_t used = 0;
+    int fields = 0;
+    s->epd_len = 0;
+    while (fields < 6) {
+        while (*p == ' ' || *p == '\t') ++p;
+        const char *start = p;
+        while (*p && *p != ' ' && *p != '\t' && *p != ';') ++p;
+        size_t len = (size_t)(p - start);
+        if (len == 0) break;
+        if (fields >= 4 && !all_digits(start, len)) break;
+        if (used + len + 2 > ANALYZE_FEN) return false;
+        if (fields) dst[used++] = ' ';
+        memcpy(dst + used, start, len);
+        used += len;
+        fields++;
+        if (fields == 4) s->epd_len = (size_t)(p - s->line);
+    }
+    dst[used] = '\0';
+    return fields >= 4;
+}
+
+static void *analyze_worker(void *arg) {
+    Pipeline *pl = (Pipeline *)arg;
+    ChessEngine *eng = chess_engine_new(pl->opt->hash_mb);
+    ChessLimits lim;
+    memset(&lim, 0, sizeof(lim));
+    lim.depth = pl->opt->depth;
+    lim.movetime_ms = pl->opt->movetime_ms;
+    lim.nodes = pl->opt->nodes;
+    for (;;) {
+        pthread_mutex_lock(&pl->lock);
+        while (pl->claim_seq == pl->read_seq && !pl->eof) pthread_cond_wait(&pl->work_cv, &pl->lock);
+        if (pl->claim_seq == pl->read_seq) {
+            pthread_mutex_unlock(&pl->lock);
+            break;
+        }
+        Slot *s = &pl->slots[pl->claim_seq++ % pl->ring];
+        pthread_mutex_unlock(&pl->lock);
+
+        s->ok = false;
+        if (eng) {
+            chess_new_game(eng);
+            s->ok = chess_set_position(eng, s->fen, NULL, 0)
+                && chess_search(eng, &lim, NULL, NULL, &s->info);
+            if (!s->ok) s->info.nodes = 0;
+        }
+
+        pthread_mutex_lock(&pl->lock);
+        s->state = SLOT_DONE;
+        pthread_cond_signal(&pl->done_cv);
+        pthread_mutex_unlock(&pl->lock);
+    }
+    chess_engine_free(eng);
+    return NULL;
+}
+
+static bool read_position(FILE *in, Slot *s) {
+    while (fgets(s->line, sizeof(s->line), in)) {
+        s->line[strcspn(s->line, "\r\n")] = '\0';
+        const char *p = s->line;
+        while (*p == ' ' || *p == '\t') ++p;
+        if (*p == '\0' || *p == '#') continue;
+        if (!extract_fen(s)) s->fen[0] = '\0';
+        return true;
+    }
+    return false;
+}
+
+static void write_result(FILE *out, const Slot *s, AnalyzeReport *rep) {
+    rep->positions++;
+    if (!s->ok) {
+        rep->errors++;
+        fprintf(out, "%s c0 \"invalid position\";\n", s->line);
+        return;
+    }
+    rep->nodes += s->info.nodes;
+    fprintf(out, "%.*s bm %s; ce %d;", (int)s->epd_len, s->line, s->info.bestmove, s->info.score_cp);
+    if (s->info.mate) fprintf(out, " dm %d;", s->info.mate);
+    fprintf(out, " acd %d; acn %llu;\n", s->info.depth, (unsigned long long)s->info.nodes);
+}
+
+void analyze_run(FILE *in, FILE *out, const AnalyzeOptions *opt, AnalyzeReport *rep) {
+    memset(rep, 0, sizeof(*rep));
+    int threads = opt->threads < 1 ? 1 : opt->threads > MAX_ANALYZE_THREADS ? MAX_ANALYZE_THREADS : opt->threads;
+    Pipeline pl;
+    memset(&pl, 0, sizeof(pl));
+    pl.opt = opt;
+    pl.ring = (uint64_t)threads * ANALYZE_SLOTS_PER_THREAD;
+    pl.slots = (Slot *)calloc((size_t)pl.ring, sizeof(Slot));
+    if (!pl.slots) return;
+    pthread_mutex_init(&pl.lock, NULL);
+    pthread_cond_init(&pl.work_cv, NULL);
+    pthread_cond_init(&pl.done_cv, NULL);
+
+    uint64_t start = now_ms();
+    pthread_t tids[MAX_ANALYZE_THREADS];
+    int started = 0;
+    for (int t = 0; t < threads; ++t) {
+        if (pthread_create(&tids[t], NULL, analyze_worker, &pl) != 0) break;
+        started++;
+    }
+
+    uint64_t write_seq = 0;
+    pthread_mutex_lock(&pl.lock);
+    for (;;) {
+        while (started > 0 && !pl.eof && pl.read_seq - write_seq < pl.ring) {
+            Slot *s = &pl.slots[pl.read_seq % pl.ring];
+            pthread_mutex_unlock(&pl.lock);
+            bool got = read_position(in, s);
+            pthread_mutex_lock(&pl.lock);
+            if (got) {
+                s->state = SLOT_READY;
+                pl.read_seq++;
+                pthread_cond_signal(&pl.work_cv);
+            } else {
+                pl.eof = true;
+                pthread_cond_broadcast(&pl.work_cv);
+            }
+        }
+        while (write_seq < pl.read_seq && pl.slots[write_seq % pl.ring].state == SLOT_DONE) {
+            Slot *s = &pl.slots[write_seq % pl.ring];
+            pthread_mutex_unlock(&pl.lock);
+            write_result(out, s, rep);
+            pthread_mutex_lock(&pl.lock);
+            s->state = SLOT_FREE;
+            write_seq++;
+        }
+        if (started == 0 || (pl.eof && write_seq == pl.read_seq)) break;
+        if (pl.eof || pl.read_seq - write_seq == pl.ring) pthread_cond_wait(&pl.done_cv, &pl.lock);
+    }
+    pl.eof = true;
+    pthread_cond_broadcast(&pl.work_cv);
+    pthread_mutex_unlock(&pl.lock);
+    for (int t = 0; t < started; ++t) pthread_join(tids[t], NULL);
+    fflush(out);
+    rep->time_ms = now_ms() - start;
+
+    pthread_cond_destroy(&pl.done_cv);
+    pthread_cond_destroy(&pl.work_cv);
+    pthread_mutex_destroy(&pl.lock);
+    free(pl.slots);
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ANALYZE_DEFAULT_HASH 4
+#define ANALYZE_DEFAULT_DEPTH 8
+
+typedef struct {
+    int depth;
+    int movetime_ms;
+    uint64_t nodes;
+    int threads;
+    size_t hash_mb;
+} AnalyzeOptions;
+
+typedef struct {
+    uint64_t positions;
+    uint64_t errors;
+    uint64_t nodes;
+    uint64_t time_ms;
+} AnalyzeReport;
+
+void analyze_run(FILE *in, FILE *out, const AnalyzeOptions *opt, AnalyzeReport *rep);
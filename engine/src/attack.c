@@ -22,3 +22,16 @@ bool is_square_attacked(const Position *pos, int sq, int by_side) {
     }
     return false;
 }
+
+U64 attackers_to(const Position *pos, int sq, U64 occ) {
+    U64 bishops = pos->bb_piece[WB - 1] | pos->bb_piece[BB - 1] |
+                  pos->bb_piece[WQ - 1] | pos->bb_piece[BQ - 1];
+    U64 rooks = pos->bb_piece[WR - 1] | pos->bb_piece[BR - 1] |
+                pos->bb_piece[WQ - 1] | pos->bb_piece[BQ - 1];
+    return (PAWN_ATTACKS[BLACK][sq] & pos->bb_piece[WP - 1])
+         | (PAWN_ATTACKS[WHITE][sq] & pos->bb_piece[BP - 1])
+         | (KNIGHT_ATTACKS[sq] & (pos->bb_piece[WN - 1] | pos->bb_piece[BN - 1]))
+         | (KING_ATTACKS[sq] & (pos->bb_piece[WK - 1] | pos->bb_piece[BK - 1]))
+         | (bishop_attacks(sq, occ) & bishops)
+         | (rook_attacks(sq, occ) & rooks);
+}
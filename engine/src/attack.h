@@ -2,3 +2,4 @@
 #include "position.h"
 
 bool is_square_attacked(const Position *pos, int sq, int by_side);
+U64 attackers_to(const Position *pos, int sq, U64 occ);
@@ -0,0 +1,16 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#define BENCH_DEFAULT_HASH 16
+#define BENCH_DEFAULT_THREADS 1
+#define BENCH_DEFAULT_DEPTH 6
+
+typedef struct {
+    uint64_t nodes;
+    uint64_t time_ms;
+    int positions;
+} BenchResult;
+
+void bench_run(size_t hash_mb, int threads, int depth, BenchResult *out);
+void bench_print(const BenchResult *res);
@@ -0,0 +1,123 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "bitbase.h"
+#include "tables.h"
+
+enum { KPK_INVALID, KPK_UNKNOWN, KPK_DRAW, KPK_WIN };
+
+/* One bit per position, set when white (the side with the pawn) wins. */
+static uint8_t KPK_BITS[KPK_SIZE / 8];
+
+static int kpk_index(int wksq, int wpsq, int bksq, int stm) {
+    int pawn = ((wpsq >> 3) - 1) * 4 + (wpsq & 7);
+    return stm + 2 * (bksq + 64 * (wksq + 64 * pawn));
+}
+
+static int distance(int a, int b) {
+    int df = abs((a & 7) - (b & 7));
+    int dr = abs((a >> 3) - (b >> 3));
+    return df > dr ? df : dr;
+}
+
+static uint8_t kpk_initial(int wksq, int wpsq, int bksq, int stm) {
+    if (distance(wksq, bksq) <= 1 || wksq == wpsq || bksq == wpsq) return KPK_INVALID;
+    if (stm == WHITE && (PAWN_ATTACKS[WHITE][wpsq] & (1ULL << bksq))) return KPK_INVALID;
+    if (stm == WHITE && (wpsq >> 3) == 6) {
+        int promo = wpsq + 8;
+        if (wksq != promo && bksq != promo && (distance(bksq, promo) > 1 || distance(wksq, promo) == 1)) {
+            return KPK_WIN;
+        }
+    }
+    if (stm == BLACK) {
+        U64 guarded = KING_ATTACKS[wksq] | PAWN_ATTACKS[WHITE][wpsq];
+        if (!(KING_ATTACKS[bksq] & ~guarded)) return KPK_DRAW;
+        if ((KING_ATTACKS[bksq] & (1ULL << wpsq)) && !(KING_ATTACKS[wksq] & (1ULL << wpsq))) return KPK_DRAW;
+    }
+    return KPK_UNKNOWN;
+}
+
+static uint8_t kpk_classify(const uint8_t *db, int wksq, int wpsq, int bksq, int stm) {
+    bool any_win = false;
+    bool any_draw = false;
+    bool any_unknown = false;
+    int them = stm ^ 1;
+    if (stm == WHITE) {
+        for (U64 m = KING_ATTACKS[wksq] & ~KING_ATTACKS[bksq] & ~(1ULL << wpsq); m; m &= m - 1) {
+            uint8_t r = db[kpk_index(lsb_index(m), wpsq, bksq, them)];
+            any_win |= r == KPK_WIN;
+            any_draw |= r == KPK_DRAW;
+            any_unknown |= r == KPK_UNKNOWN;
+        }
+        int push = wpsq + 8;
+        if ((wpsq >> 3) < 6 && push != wksq && push != bksq) {
+            uint8_t r = db[kpk_index(wksq, push, bksq, them)];
+            any_win |= r == KPK_WIN;
+            any_draw |= r == KPK_DRAW;
+            any_unknown |= r == KPK_UNKNOWN;
+            int dbl = push + 8;
+            if ((wpsq >> 3) == 1 && dbl != wksq && dbl != bksq) {
+                r = db[kpk_index(wksq, dbl, bksq, them)];
+                any_win |= r == KPK_WIN;
+                any_draw |= r == KPK_DRAW;
+                any_unknown |= r == KPK_UNKNOWN;
+            }
+        }
+        if (any_win) return KPK_WIN;
+        return any_unknown ? KPK_UNKNOWN : KPK_DRAW;
+    }
+    U64 guarded = KING_ATTACKS[wksq] | PAWN_ATTACKS[WHITE][wpsq] | (1ULL << wpsq);
+    for (U64 m = KING_ATTACKS[bksq] & ~guarded; m; m &= m - 1) {
+        uint8_t r = db[kpk_index(wksq, wpsq, lsb_index(m), them)];
+        any_win |= r == KPK_WIN;
+        any_draw |= r == KPK_DRAW;
+        any_unknown |= r == KPK_UNKNOWN;
+    }
+    if (any_draw) return KPK_DRAW;
+    return any_unknown ? KPK_UNKNOWN : KPK_WIN;
+}
+
+void bitbase_init(void) {
+    uint8_t *db = (uint8_t *)malloc(KPK_SIZE);
+    if (!db) return;
+    for (int pawn = 0; pawn < 24; ++pawn) {
+        int wpsq = ((pawn >> 2) + 1) * 8 + (pawn & 3);
+        for (int wksq = 0; wksq < 64; ++wksq) {
+            for (int bksq = 0; bksq < 64; ++bksq) {
+                for (int stm = WHITE; stm <= BLACK; ++stm) {
+                    db[kpk_index(wksq, wpsq, bksq, stm)] = kpk_initial(wksq, wpsq, bksq, stm);
+                }
+            }
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int pawn = 0; pawn < 24; ++pawn) {
+            int wpsq = ((pawn >> 2) + 1) * 8 + (pawn & 3);
+            for (int wksq = 0; wksq < 64; ++wksq) {
+                for (int bksq = 0; bksq < 64; ++bksq) {
+                    for (int stm = WHITE; stm <= BLACK; ++stm) {
+                        int idx = kpk_index(wksq, wpsq, bksq, stm);
+                        if (db[idx] != KPK_UNKNOWN) continue;
+                        db[idx] = kpk_classify(db, wksq, wpsq, bksq, stm);
+                        changed |= db[idx] != KPK_UNKNOWN;
+                    }
+                }
+            }
+        }
+    }
+    for (int i = 0; i < KPK_SIZE; ++i) {
+        if (db[i] == KPK_WIN) KPK_BITS[i >> 3] |= (uint8_t)(1u << (i & 7));
+    }
+    free(db);
+}
+
+bool kpk_probe(int wksq, int wpsq, int bksq, int stm) {
+    if ((wpsq & 7) > 3) {
+        wksq ^= 7;
+        wpsq ^= 7;
+        bksq ^= 7;
+    }
+    int idx = kpk_index(wksq, wpsq, bksq, stm);
+    return (KPK_BITS[idx >> 3] >> (idx & 7)) & 1;
+}
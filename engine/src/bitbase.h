@@ -0,0 +1,7 @@
+#pragma once
+#include <stdbool.h>
+
+#define KPK_SIZE (2 * 64 * 64 * 24)
+
+void bitbase_init(void);
+bool kpk_probe(int wksq, int wpsq, int bksq, int stm);
@@ -0,0 +1,22 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "position.h"
+
+#define BOOK_ENTRY_SIZE 16
+#define POLYGLOT_STARTPOS_KEY 0x463b96181691fc9cULL
+#define POLYGLOT_E2E4_KEY 0x823c9b50fd114196ULL
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t n;
+} Book;
+
+bool book_keys_valid(void);
+uint64_t book_key(const Position *pos);
+
+bool book_open(Book *book, const char *path);
+void book_close(Book *book);
+Move book_probe(const Book *book, const Position *pos, bool best, uint64_t *rng);
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "booksuite.h"
+#include "book.h"
+
+typedef struct {
+    char fen[256];
+    uint64_t key;
+    bool has_key;
+    char bm[8];
+} BookEntry;
+
+static bool parse_epd_line(const char *line, BookEntry *e) {
+    memset(e, 0, sizeof(*e));
+    const char *semi = strchr(line, ';');
+    if (!semi) return false;
+    size_t len = (size_t)(semi - line);
+    while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t')) --len;
+    if (len == 0 || len >= sizeof(e->fen)) return false;
+    memcpy(e->fen, line, len);
+    e->fen[len] = '\0';
+
+    const char *p = semi;
+    while ((p = strchr(p, ';')) != NULL) {
+        ++p;
+        while (*p == ' ') ++p;
+        if (!strncmp(p, "key ", 4)) {
+            e->key = strtoull(p + 4, NULL, 16);
+            e->has_key = true;
+        } else if (!strncmp(p, "bm ", 3)) {
+            sscanf(p + 3, "%7s", e->bm);
+        }
+    }
+    return true;
+}
+
+/* Checks book_key() against the listed Polyglot keys, then plays each position through the
+ * engine with BookBestMove set and expects the listed book move. */
+int book_suite_run(ChessEngine *eng, const char *book_path, const char *epd_path) {
+    FILE *f = fopen(epd_path, "r");
+    if (!f) {
+        printf("booksuite: cannot open %s\n", epd_path);
+        return -1;
+    }
+    if (!chess_set_option(eng, "BookFile", book_path) || !chess_set_option(eng, "BookBestMove", "true")) {
+        printf("booksuite: cannot open book %s\n", book_path);
+        fclose(f);
+        return -1;
+    }
+    Position *pos = (Position *)malloc(sizeof(Position));
+    if (!pos) {
+        fclose(f);
+        return -1;
+    }
+
+    int failures = book_keys_valid() ? 0 : 1;
+    printf("startpos and e2e4 keys %s\n", failures ? "FAIL" : "ok");
+    printf("%3s %16s %6s  %-6s %s\n", "#", "key", "move", "result", "fen");
+    char line[1024];
+    int index = 0;
+    while (fgets(line, sizeof(line), f)) {
+        BookEntry e;
+        if (line[0] == '#' || !parse_epd_line(line, &e)) continue;
+        ++index;
+        if (!pos_from_fen(pos, e.fen) || !chess_set_position(eng, e.fen, NULL, 0)) {
+            printf("%3d %16s %6s  %-6s %s\n", index, "-", "-", "BADFEN", e.fen);
+            failures++;
+            continue;
+        }
+        uint64_t key = book_key(pos);
+        bool ok = !e.has_key || key == e.key;
+        char move[8] = "-";
+        if (e.bm[0]) {
+            ChessLimits lim;
+            memset(&lim, 0, sizeof(lim));
+            lim.depth = 1;
+            ChessInfo info;
+            ok = chess_search(eng, &lim, NULL, NULL, &info) && ok;
+            snprintf(move, sizeof(move), "%s", info.bestmove);
+            ok = ok && info.depth == 0 && !strcmp(info.bestmove, e.bm);
+        }
+        if (!ok) failures++;
+        printf("%3d %016llx %6s  %-6s %s\n", index, (unsigned long long)key, move, ok ? "ok" : "FAIL", e.fen);
+    }
+    fclose(f);
+    free(pos);
+    printf("failures %d\n", failures);
+    fflush(stdout);
+    return failures;
+}
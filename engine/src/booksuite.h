@@ -0,0 +1,4 @@
+#pragma once
+#include "chessv2.h"
+
+int book_suite_run(ChessEngine *eng, const char *book_path, const char *epd_path);
@@ -0,0 +1,409 @@
+#include <stdlib.h>
+#include <string.h>
+#include "chessv2.h"
+#include "position.h"
+#include "search.h"
+#include "movegen.h"
+#include "make.h"
+#include "perft.h"
+#include "eval.h"
+#include "time.h"
+#include "stats.h"
+#include "book.h"
+#include "tb.h"
+#include "mate.h"
+
+struct ChessEngine {
+    Position pos;
+    SearchCtx ctx;
+    PerftTT perft_tt;
+    size_t hash_mb;
+    int threads;
+    char base_fen[128];
+    Move history[MAX_GAME_PLY];
+    int n_history;
+    SearchStats stats;
+    TraceWriter trace;
+    Book book;
+    int book_depth;
+    bool book_best;
+    uint64_t book_rng;
+    MateSearch mate;
+};
+
+typedef struct {
+    ChessProgressFn fn;
+    void *user;
+    SearchInfo last;
+} ProgressBridge;
+
+static const char *STARTPOS_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+static void move_to_uci(Move mv, char *out) {
+    int from = M_FROM(mv);
+    int to = M_TO(mv);
+    out[0] = (char)('a' + (from & 7));
+    out[1] = (char)('1' + (from >> 3));
+    out[2] = (char)('a' + (to & 7));
+    out[3] = (char)('1' + (to >> 3));
+    int idx = 4;
+    if (M_FLAGS(mv) & FLAG_PROMO) {
+        Piece p = M_PROMO(mv);
+        char c = 'q';
+        if (p == WR || p == BR) c = 'r';
+        else if (p == WB || p == BB) c = 'b';
+        else if (p == WN || p == BN) c = 'n';
+        out[idx++] = c;
+    }
+    out[idx] = '\0';
+}
+
+static Move move_from_uci(const Position *pos, const char *str) {
+    size_t len = strlen(str);
+    if (len < 4 || len > 5) return 0;
+    if (str[0] < 'a' || str[0] > 'h' || str[1] < '1' || str[1] > '8') return 0;
+    if (str[2] < 'a' || str[2] > 'h' || str[3] < '1' || str[3] > '8') return 0;
+    int from = (str[1] - '1') * 8 + (str[0] - 'a');
+    int to = (str[3] - '1') * 8 + (str[2] - 'a');
+    int promo = 0;
+    if (len == 5) {
+        switch (str[4]) {
+            case 'n': promo = 1; break;
+            case 'b': promo = 2; break;
+            case 'r': promo = 3; break;
+            case 'q': promo = 4; break;
+            default: return 0;
+        }
+    }
+    return move_from_squares(pos, from, to, promo);
+}
+
+static bool same_move(Move mv, const char *str) {
+    char buf[6];
+    move_to_uci(mv, buf);
+    return !strcmp(buf, str);
+}
+
+static void set_base(ChessEngine *eng, const char *fen) {
+    size_t len = strlen(fen);
+    if (len < sizeof(eng->base_fen)) {
+        memcpy(eng->base_fen, fen, len + 1);
+    } else {
+        eng->base_fen[0] = '\0';
+    }
+    eng->n_history = 0;
+}
+
+static void fill_info(ChessInfo *out, const SearchInfo *info) {
+    memset(out, 0, sizeof(*out));
+    out->depth = info->depth;
+    out->score_cp = info->score;
+    if (info->score > MATE - MAX_PLY) out->mate = (MATE - info->score + 1) / 2;
+    else if (info->score < -MATE + MAX_PLY) out->mate = -(MATE + info->score) / 2;
+    out->nodes = info->nodes;
+    out->time_ms = info->time_ms;
+    out->tbhits = info->tbhits;
+    if (info->best) move_to_uci(info->best, out->bestmove);
+    else strcpy(out->bestmove, "0000");
+}
+
+static void progress_bridge(const SearchInfo *info, void *user) {
+    ProgressBridge *bridge = (ProgressBridge *)user;
+    bridge->last = *info;
+    if (!bridge->fn) return;
+    ChessInfo out;
+    fill_info(&out, info);
+    bridge->fn(&out, bridge->user);
+}
+
+ChessEngine *chess_engine_new(size_t hash_mb) {
+    ChessEngine *eng = (ChessEngine *)calloc(1, sizeof(*eng));
+    if (!eng) return NULL;
+    search_init(&eng->ctx, hash_mb);
+    if (!eng->ctx.tt.t) {
+        free(eng);
+        return NULL;
+    }
+    eng->hash_mb = hash_mb;
+    eng->threads = 1;
+    eng->book_depth = CHESS_BOOK_DEPTH;
+    eng->ctx.tb_limit = CHESS_TB_PROBE_LIMIT;
+    eng->book_rng = now_ms() | 1;
+    pos_from_fen(&eng->pos, STARTPOS_FEN);
+    set_base(eng, STARTPOS_FEN);
+    return eng;
+}
+
+void chess_engine_free(ChessEngine *eng) {
+    if (!eng) return;
+    search_quit(&eng->ctx);
+    perft_tt_free(&eng->perft_tt);
+    trace_close(&eng->trace);
+    book_close(&eng->book);
+    mate_free(&eng->mate);
+    free(eng);
+}
+
+void chess_new_game(ChessEngine *eng) {
+    search_clear(&eng->ctx);
+    pos_from_fen(&eng->pos, STARTPOS_FEN);
+    set_base(eng, STARTPOS_FEN);
+}
+
+bool chess_set_position(ChessEngine *eng, const char *fen, const char *const *moves, int n_moves) {
+    const char *base = fen ? fen : STARTPOS_FEN;
+    int keep = 0;
+    if (eng->base_fen[0] && !strcmp(base, eng->base_fen)) {
+        int limit = n_moves < eng->n_history ? n_moves : eng->n_history;
+        while (keep < limit && same_move(eng->history[keep], moves[keep])) keep++;
+        while (eng->n_history > keep) chess_pop_move(eng);
+    } else if (pos_from_fen(&eng->pos, base)) {
+        set_base(eng, base);
+    } else {
+        pos_from_fen(&eng->pos, STARTPOS_FEN);
+        set_base(eng, STARTPOS_FEN);
+        return false;
+    }
+    for (int i = keep; i < n_moves; ++i) {
+        if (!chess_push_move(eng, moves[i])) return false;
+    }
+    return true;
+}
+
+bool chess_push_move(ChessEngine *eng, const char *uci) {
+    if (eng->n_history >= MAX_GAME_PLY) return false;
+    Move mv = move_from_uci(&eng->pos, uci);
+    if (!mv || !make_move(&eng->pos, mv)) return false;
+    eng->history[eng->n_history++] = mv;
+    return true;
+}
+
+bool chess_pop_move(ChessEngine *eng) {
+    if (eng->n_history == 0) return false;
+    undo_move(&eng->pos, eng->history[--eng->n_history]);
+    return true;
+}
+
+int chess_side_to_move(const ChessEngine *eng) {
+    return eng->pos.side;
+}
+
+int chess_move_count(const ChessEngine *eng) {
+    return eng->n_history;
+}
+
+void chess_print_board(const ChessEngine *eng) {
+    int last_from = -1;
+    int last_to = -1;
+    if (eng->n_history > 0) {
+        Move mv = eng->history[eng->n_history - 1];
+        last_from = M_FROM(mv);
+        last_to = M_TO(mv);
+    }
+    pos_print_pretty(&eng->pos, last_from, last_to);
+}
+
+bool chess_get_fen(const ChessEngine *eng, char *buf, size_t size) {
+    if (!buf || size == 0) return false;
+    pos_to_fen(&eng->pos, buf, size);
+    return true;
+}
+
+ChessStatus chess_status(const ChessEngine *eng) {
+    const Position *pos = &eng->pos;
+    MoveList list;
+    gen_pseudo_legal(pos, &list);
+    bool has_move = false;
+    for (int i = 0; i < list.n && !has_move; ++i) has_move = move_is_legal(pos, list.m[i]);
+    if (!has_move) return in_check(pos, pos->side) ? CHESS_CHECKMATE : CHESS_STALEMATE;
+    if (pos->halfmove_clock >= 100) return CHESS_DRAW_FIFTY;
+    if (pos_repetitions(pos) >= 2) return CHESS_DRAW_REPETITION;
+    if (pos_insufficient_material(pos)) return CHESS_DRAW_MATERIAL;
+    return CHESS_ONGOING;
+}
+
+static bool mate_search_root(ChessEngine *eng, const ChessLimits *lim, ChessProgressFn fn, void *user,
+                             ChessInfo *out) {
+    ChessInfo info;
+    memset(&info, 0, sizeof(info));
+    strcpy(info.bestmove, "0000");
+    if (!eng->mate.t && !mate_init(&eng->mate, MATE_HASH_MB)) {
+        if (out) *out = info;
+        return false;
+    }
+    uint64_t start = now_ms();
+    eng->mate.max_nodes = lim->nodes;
+    eng->mate.deadline_ms = lim->movetime_ms > 0 ? start + (uint64_t)lim->movetime_ms : 0;
+    Move pv[2 * MATE_MAX_MOVES];
+    int pv_len = 0;
+    int moves = mate_search(&eng->mate, &eng->pos, lim->mate, pv, &pv_len);
+    info.nodes = eng->mate.nodes;
+    info.time_ms = now_ms() - start;
+    if (moves > 0 && pv_len > 0) {
+        info.depth = 2 * moves - 1;
+        info.mate = moves;
+        info.score_cp = MATE - info.depth;
+        move_to_uci(pv[0], info.bestmove);
+        size_t len = 0;
+        for (int i = 0; i < pv_len && len + 6 < sizeof(info.pv); ++i) {
+            if (len) info.pv[len++] = ' ';
+            move_to_uci(pv[i], info.pv + len);
+            len += strlen(info.pv + len);
+        }
+        if (fn) fn(&info, user);
+    }
+    if (out) *out = info;
+    return moves > 0;
+}
+
+bool chess_search(ChessEngine *eng, const ChessLimits *lim, ChessProgressFn fn, void *user, ChessInfo *out) {
+    if (lim->mate > 0) return mate_search_root(eng, lim, fn, user, out);
+
+    SearchLimits sl;
+    memset(&sl, 0, sizeof(sl));
+    sl.max_depth = lim->depth;
+    sl.movetime_ms = lim->movetime_ms;
+    sl.wtime_ms = lim->wtime_ms;
+    sl.btime_ms = lim->btime_ms;
+    sl.winc_ms = lim->winc_ms;
+    sl.binc_ms = lim->binc_ms;
+    sl.max_nodes = lim->nodes;
+
+    if (eng->book.data && eng->n_history < eng->book_depth) {
+        uint64_t start = now_ms();
+        Move mv = book_probe(&eng->book, &eng->pos, eng->book_best, &eng->book_rng);
+        if (mv) {
+            SearchInfo info;
+            memset(&info, 0, sizeof(info));
+            info.best = mv;
+            info.time_ms = now_ms() - start;
+            if (out) fill_info(out, &info);
+            return true;
+        }
+    }
+
+    ProgressBridge bridge;
+    memset(&bridge, 0, sizeof(bridge));
+    bridge.fn = fn;
+    bridge.user = user;
+    eng->ctx.on_info = progress_bridge;
+    eng->ctx.on_info_user = &bridge;
+
+    Move best = search_bestmove(&eng->ctx, &eng->pos, &sl);
+    eng->ctx.on_info = NULL;
+    eng->ctx.on_info_user = NULL;
+    stats_snapshot(&eng->stats);
+
+    SearchInfo last = bridge.last;
+    last.best = best;
+    last.nodes = eng->ctx.lim.nodes;
+    last.time_ms = now_ms() - eng->ctx.lim.start_ms;
+    last.tbhits = eng->ctx.tbhits;
+    if (out) {
+        fill_info(out, &last);
+        out->cutoffs = eng->ctx.order.cutoffs;
+        out->first_move_cutoffs = eng->ctx.order.first_move_cutoffs;
+    }
+    return best != 0;
+}
+
+void chess_print_stats(const ChessEngine *eng) {
+    stats_print(&eng->stats);
+}
+
+void chess_stop(ChessEngine *eng) {
+    eng->ctx.lim.stop = 1;
+}
+
+uint64_t chess_perft(ChessEngine *eng, int depth) {
+    return perft_parallel(&eng->pos, depth, &eng->perft_tt, eng->threads, NULL, NULL);
+}
+
+typedef struct {
+    ChessDivideFn fn;
+    void *user;
+} DivideBridge;
+
+static void divide_bridge(Move mv, uint64_t nodes, void *user) {
+    const DivideBridge *bridge = (const DivideBridge *)user;
+    char buf[6];
+    move_to_uci(mv, buf);
+    bridge->fn(buf, nodes, bridge->user);
+}
+
+uint64_t chess_divide(ChessEngine *eng, int depth, ChessDivideFn fn, void *user) {
+    DivideBridge bridge = {fn, user};
+    return perft_parallel(&eng->pos, depth, &eng->perft_tt, eng->threads,
+                          fn ? divide_bridge : NULL, &bridge);
+}
+
+static bool parse_size(const char *value, size_t max, size_t *out) {
+    char *end = NULL;
+    long long v = strtoll(value, &end, 10);
+    if (end == value || v < 0 || (unsigned long long)v > max) return false;
+    *out = (size_t)v;
+    return true;
+}
+
+bool chess_set_option(ChessEngine *eng, const char *name, const char *value) {
+    size_t v = 0;
+    if (!strcmp(name, "Hash")) {
+        if (!parse_size(value, 65536, &v) || v < 1) return false;
+        if (v == eng->hash_mb) return true;
+        TT tt;
+        tt_init(&tt, v);
+        if (!tt.t) return false;
+        tt_free(&eng->ctx.tt);
+        eng->ctx.tt = tt;
+        eng->hash_mb = v;
+        return true;
+    }
+    if (!strcmp(name, "Threads")) {
+        if (!parse_size(value, 1024, &v) || v < 1) return false;
+        eng->threads = (int)v;
+        return true;
+    }
+    if (!strcmp(name, "PerftHash")) {
+        if (!parse_size(value, 65536, &v)) return false;
+        perft_tt_free(&eng->perft_tt);
+        perft_tt_init(&eng->perft_tt, v);
+        return v == 0 || eng->perft_tt.t != NULL;
+    }
+    if (!strcmp(name, "BookFile")) {
+        book_close(&eng->book);
+        if (!value[0] || !strcmp(value, "<empty>")) return true;
+        return book_open(&eng->book, value);
+    }
+    if (!strcmp(name, "BookDepth")) {
+        if (!parse_size(value, MAX_GAME_PLY, &v)) return false;
+        eng->book_depth = (int)v;
+        return true;
+    }
+    if (!strcmp(name, "BookBestMove")) {
+        eng->book_best = !strcmp(value, "true");
+        return eng->book_best || !strcmp(value, "false");
+    }
+    if (!strcmp(name, "SyzygyPath")) {
+        if (!value[0] || !strcmp(value, "<empty>")) value = "";
+        int n = tb_init(value);
+        return n > 0 || (n == 0 && !value[0]);
+    }
+    if (!strcmp(name, "SyzygyProbeLimit")) {
+        if (!parse_size(value, TB_MAX_PIECES, &v)) return false;
+        eng->ctx.tb_limit = (int)v;
+        return true;
+    }
+    if (!strcmp(name, "TraceFile")) {
+        trace_close(&eng->trace);
+        eng->ctx.trace = NULL;
+        if (!value[0] || !strcmp(value, "<empty>")) return true;
+        if (!trace_open(&eng->trace, value)) return false;
+        eng->ctx.trace = &eng->trace;
+        return true;
+    }
+    return false;
+}
+
+int chess_eval(const ChessEngine *eng) {
+    return eval(&eng->pos);
+}
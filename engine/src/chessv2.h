@@ -0,0 +1,75 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ChessEngine ChessEngine;
+
+enum { CHESS_WHITE = 0, CHESS_BLACK = 1 };
+
+#define CHESS_BOOK_DEPTH 20
+#define CHESS_TB_PROBE_LIMIT 7
+#define CHESS_PV_CHARS 400
+
+typedef enum {
+    CHESS_ONGOING = 0,
+    CHESS_CHECKMATE,
+    CHESS_STALEMATE,
+    CHESS_DRAW_REPETITION,
+    CHESS_DRAW_FIFTY,
+    CHESS_DRAW_MATERIAL
+} ChessStatus;
+
+typedef struct {
+    int depth;
+    int movetime_ms;
+    int wtime_ms, btime_ms, winc_ms, binc_ms;
+    uint64_t nodes;
+    int mate;
+} ChessLimits;
+
+typedef struct {
+    int depth;
+    int score_cp;
+    int mate;
+    uint64_t nodes;
+    uint64_t time_ms;
+    uint64_t cutoffs;
+    uint64_t first_move_cutoffs;
+    char bestmove[6];
+    uint64_t tbhits;
+    char pv[CHESS_PV_CHARS];
+} ChessInfo;
+
+typedef void (*ChessProgressFn)(const ChessInfo *info, void *user);
+typedef void (*ChessDivideFn)(const char *move, uint64_t nodes, void *user);
+
+ChessEngine *chess_engine_new(size_t hash_mb);
+void chess_engine_free(ChessEngine *eng);
+void chess_new_game(ChessEngine *eng);
+bool chess_set_option(ChessEngine *eng, const char *name, const char *value);
+
+bool chess_set_position(ChessEngine *eng, const char *fen, const char *const *moves, int n_moves);
+bool chess_push_move(ChessEngine *eng, const char *uci);
+bool chess_pop_move(ChessEngine *eng);
+int chess_side_to_move(const ChessEngine *eng);
+int chess_move_count(const ChessEngine *eng);
+void chess_print_board(const ChessEngine *eng);
+bool chess_get_fen(const ChessEngine *eng, char *buf, size_t size);
+ChessStatus chess_status(const ChessEngine *eng);
+
+bool chess_search(ChessEngine *eng, const ChessLimits *lim, ChessProgressFn fn, void *user, ChessInfo *out);
+void chess_stop(ChessEngine *eng);
+void chess_print_stats(const ChessEngine *eng);
+
+uint64_t chess_perft(ChessEngine *eng, int depth);
+uint64_t chess_divide(ChessEngine *eng, int depth, ChessDivideFn fn, void *user);
+int chess_eval(const ChessEngine *eng);
+
+#ifdef __cplusplus
+}
+#endif
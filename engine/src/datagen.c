@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "datagen.h"
+#include "packed.h"
+#include "search.h"
+#include "movegen.h"
+#include "make.h"
+#include "time.h"
+
+#define DATAGEN_BUFFER 4096
+#define DATAGEN_MAX_PLIES 400
+#define DATAGEN_MAX_THREADS 256
+#define DATAGEN_ADJUDICATE_PLIES 8
+#define DATAGEN_WIN_SCORE 2500
+
+typedef struct {
+    const DatagenOptions *opt;
+    FILE *out;
+    pthread_mutex_t out_lock;
+    atomic_ullong next_game;
+    atomic_ullong positions;
+    bool write_failed;
+} Datagen;
+
+typedef struct {
+    Datagen *dg;
+    PackedPos buf[DATAGEN_BUFFER];
+    int n;
+} Writer;
+
+static void writer_flush(Writer *w) {
+    if (w->n == 0) return;
+    pthread_mutex_lock(&w->dg->out_lock);
+    if (fwrite(w->buf, sizeof(PackedPos), (size_t)w->n, w->dg->out) != (size_t)w->n) {
+        w->dg->write_failed = true;
+    }
+    pthread_mutex_unlock(&w->dg->out_lock);
+    atomic_fetch_add(&w->dg->positions, (unsigned long long)w->n);
+    w->n = 0;
+}
+
+static void writer_push(Writer *w, const PackedPos *rec) {
+    w->buf[w->n++] = *rec;
+    if (w->n == DATAGEN_BUFFER) writer_flush(w);
+}
+
+static uint64_t rng_next(uint64_t *s) {
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * UINT64_C(2685821657736338717);
+}
+
+static int legal_moves(const Position *pos, MoveList *list) {
+    gen_pseudo_legal(pos, list);
+    int n = 0;
+    for (int i = 0; i < list->n; ++i) {
+        if (move_is_legal(pos, list->m[i])) list->m[n++] = list->m[i];
+    }
+    list->n = n;
+    return n;
+}
+
+static bool random_opening(Position *pos, uint64_t *rng, int plies) {
+    static const char *STARTPOS = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    pos_from_fen(pos, STARTPOS);
+    MoveList list;
+    for (int i = 0; i < plies; ++i) {
+        if (!legal_moves(pos, &list)) return false;
+        make_move(pos, list.m[rng_next(rng) % (uint64_t)list.n]);
+    }
+    return legal_moves(pos, &list) > 0;
+}
+
+/* Keeps the score of the last completed iteration; a search that completes none leaves -INF. */
+static void record_info(const SearchInfo *info, void *user) {
+    *(int *)user = info->score;
+}
+
+static void play_game(SearchCtx *ctx, Position *pos, PackedPos *game, Writer *w, uint64_t *rng) {
+    const DatagenOptions *opt = w->dg->opt;
+    int plies = opt->random_plies + (int)(rng_next(rng) % 2);
+    while (!random_opening(pos, rng, plies)) {
+    }
+    search_clear(ctx);
+
+    int n = 0;
+    int result = 0;
+    int win_streak = 0;
+    int loss_streak = 0;
+    SearchLimits lim;
+    memset(&lim, 0, sizeof(lim));
+    lim.max_nodes = opt->nodes;
+    int score;
+    ctx->on_info = record_info;
+    ctx->on_info_user = &score;
+
+    for (int ply = 0; ply < DATAGEN_MAX_PLIES; ++ply) {
+        MoveList list;
+        if (!legal_moves(pos, &list)) {
+            if (in_check(pos, pos->side)) result = pos->side == WHITE ? -1 : 1;
+            break;
+        }
+        if (pos->halfmove_clock >= 100 || pos_repetitions(pos) >= 2 || pos_insufficient_material(pos)) break;
+
+        score = -INF;
+        Move best = search_bestmove(ctx, pos, &lim);
+        if (!best) break;
+        if (score == -INF) {
+            make_move(pos, best);
+            continue;
+        }
+        int white_score = pos->side == WHITE ? score : -score;
+        if (white_score >= DATAGEN_WIN_SCORE) {
+            win_streak++;
+            loss_streak = 0;
+        } else if (white_score <= -DATAGEN_WIN_SCORE) {
+            loss_streak++;
+            win_streak = 0;
+        } else {
+            win_streak = loss_streak = 0;
+        }
+        if (win_streak >= DATAGEN_ADJUDICATE_PLIES || loss_streak >= DATAGEN_ADJUDICATE_PLIES) {
+            result = win_streak ? 1 : -1;
+            break;
+        }
+
+        bool quiet = !(M_FLAGS(best) & (FLAG_CAPTURE | FLAG_PROMO));
+        bool decisive = score >= MATE - MAX_PLY || score <= -MATE + MAX_PLY;
+        if (quiet && !decisive && !in_check(pos, pos->side)) pack_position(pos, score, 0, &game[n++]);
+        make_move(pos, best);
+    }
+    ctx->on_info = NULL;
+    ctx->on_info_user = NULL;
+
+    for (int i = 0; i < n; ++i) {
+        game[i].result = (int8_t)result;
+        writer_push(w, &game[i]);
+    }
+}
+
+static void *datagen_worker(void *arg) {
+    Datagen *dg = (Datagen *)arg;
+    SearchCtx *ctx = (SearchCtx *)malloc(sizeof(SearchCtx));
+    Position *pos = (Position *)malloc(sizeof(Position));
+    Writer *w = (Writer *)malloc(sizeof(Writer));
+    PackedPos *game = (PackedPos *)malloc(DATAGEN_MAX_PLIES * sizeof(PackedPos));
+    if (ctx && pos && w && game) {
+        search_init(ctx, dg->opt->hash_mb);
+        w->dg = dg;
+        w->n = 0;
+        for (;;) {
+            unsigned long long g = atomic_fetch_add(&dg->next_game, 1);
+            if (g >= dg->opt->games) break;
+            uint64_t rng = dg->opt->seed ^ ((g + 1) * UINT64_C(0x9e3779b97f4a7c15));
+            if (!rng) rng = 1;
+            play_game(ctx, pos, game, w, &rng);
+        }
+        writer_flush(w);
+        search_quit(ctx);
+    }
+    free(game);
+    free(w);
+    free(pos);
+    free(ctx);
+    return NULL;
+}
+
+bool datagen_run(const DatagenOptions *opt, DatagenReport *rep) {
+    memset(rep, 0, sizeof(*rep));
+    Datagen dg;
+    memset(&dg, 0, sizeof(dg));
+    dg.opt = opt;
+    dg.out = fopen(opt->out_path, "wb");
+    if (!dg.out) return false;
+    pthread_mutex_init(&dg.out_lock, NULL);
+    atomic_init(&dg.next_game, 0);
+    atomic_init(&dg.positions, 0);
+
+    uint64_t start = now_ms();
+    int threads = opt->threads < 1 ? 1 : opt->threads > DATAGEN_MAX_THREADS ? DATAGEN_MAX_THREADS : opt->threads;
+    pthread_t tids[DATAGEN_MAX_THREADS];
+    int started = 0;
+    for (int t = 0; t < threads; ++t) {
+        if (pthread_create(&tids[t], NULL, datagen_worker, &dg) != 0) break;
+        started++;
+    }
+    if (started == 0) datagen_worker(&dg);
+    for (int t = 0; t < started; ++t) pthread_join(tids[t], NULL);
+
+    bool ok = fclose(dg.out) == 0 && !dg.write_failed;
+    pthread_mutex_destroy(&dg.out_lock);
+    rep->games = opt->games;
+    rep->positions = atomic_load(&dg.positions);
+    rep->time_ms = now_ms() - start;
+    return ok;
+}
+
+int datagen_dump(const char *path, uint64_t limit) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        printf("datagen: cannot open %s\n", path);
+        return -1;
+    }
+    PackedPos rec;
+    Position *pos = (Position *)malloc(sizeof(Position));
+    uint64_t count = 0;
+    int bad = 0;
+    while (pos && (!limit || count < limit) && fread(&rec, sizeof(rec), 1, f) == 1) {
+        int score = 0;
+        int result = 0;
+        char fen[128];
+        count++;
+        if (!unpack_position(&rec, pos, &score, &result)) {
+            printf("record %llu: invalid\n", (unsigned long long)count);
+            bad++;
+            continue;
+        }
+        pos_to_fen(pos, fen, sizeof(fen));
+        char *fullmove = strrchr(fen, ' ');
+        if (fullmove) *fullmove = '\0';
+        printf("%s %u ; score %d ; result %s\n", fen, rec.fullmove, score,
+               result > 0 ? "1-0" : result < 0 ? "0-1" : "1/2-1/2");
+    }
+    free(pos);
+    fclose(f);
+    return bad;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    const char *out_path;
+    uint64_t games;
+    uint64_t nodes;
+    int threads;
+    int random_plies;
+    uint64_t seed;
+    size_t hash_mb;
+} DatagenOptions;
+
+typedef struct {
+    uint64_t games;
+    uint64_t positions;
+    uint64_t time_ms;
+} DatagenReport;
+
+bool datagen_run(const DatagenOptions *opt, DatagenReport *rep);
+int datagen_dump(const char *path, uint64_t limit);
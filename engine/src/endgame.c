@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include "endgame.h"
+#include "bitbase.h"
+#include "eval_weights.h"
+
+#define K2 (MAT_KEY(WK) + MAT_KEY(BK))
+#define DARK_SQUARES 0xAA55AA55AA55AA55ULL
+
+typedef EndgameResult (*EndgameFn)(const Position *pos, int strong, int *score);
+
+static int distance(int a, int b) {
+    int df = abs((a & 7) - (b & 7));
+    int dr = abs((a >> 3) - (b >> 3));
+    return df > dr ? df : dr;
+}
+
+static int edge_bonus(int sq) {
+    int file = sq & 7;
+    int rank = sq >> 3;
+    int df = file < 4 ? 3 - file : file - 4;
+    int dr = rank < 4 ? 3 - rank : rank - 4;
+    return 20 * (df + dr);
+}
+
+static int close_bonus(int a, int b) {
+    return 70 - 10 * distance(a, b);
+}
+
+static int non_pawn_material(const Position *pos, int side) {
+    int total = 0;
+    int first = side == WHITE ? WN : BN;
+    for (int p = first; p < first + 4; ++p) total += PIECE_VALUE[p] * popcount64(pos->bb_piece[p - 1]);
+    return total;
+}
+
+static EndgameResult eg_draw(const Position *pos, int strong, int *score) {
+    (void)pos;
+    (void)strong;
+    *score = 0;
+    return ENDGAME_EXACT;
+}
+
+static EndgameResult eg_kpk(const Position *pos, int strong, int *score) {
+    Piece pawn = strong == WHITE ? WP : BP;
+    int flip = strong == WHITE ? 0 : 56;
+    int wksq = pos->king_sq[strong] ^ flip;
+    int bksq = pos->king_sq[strong ^ 1] ^ flip;
+    int wpsq = lsb_index(pos->bb_piece[pawn - 1]) ^ flip;
+    int stm = pos->side == strong ? WHITE : BLACK;
+    *score = kpk_probe(wksq, wpsq, bksq, stm) ? KNOWN_WIN + PIECE_VALUE[WP] + 10 * (wpsq >> 3) : 0;
+    return ENDGAME_EXACT;
+}
+
+static EndgameResult eg_kbnk(const Position *pos, int strong, int *score) {
+    int weak_king = pos->king_sq[strong ^ 1];
+    Piece bishop = strong == WHITE ? WB : BB;
+    bool dark = (pos->bb_piece[bishop - 1] & DARK_SQUARES) != 0;
+    int corner = dark ? 0 : 7;
+    int to_corner = distance(weak_king, corner);
+    int other = distance(weak_king, corner ^ 63);
+    if (other < to_corner) to_corner = other;
+    *score = KNOWN_WIN + non_pawn_material(pos, strong) + 40 * (7 - to_corner)
+             + close_bonus(pos->king_sq[strong], weak_king);
+    return ENDGAME_SCORE;
+}
+
+static EndgameResult eg_kxk(const Position *pos, int strong, int *score) {
+    int weak_king = pos->king_sq[strong ^ 1];
+    *score = KNOWN_WIN + non_pawn_material(pos, strong) + edge_bonus(weak_king)
+             + close_bonus(pos->king_sq[strong], weak_king);
+    return ENDGAME_SCORE;
+}
+
+static const struct {
+    uint64_t key;
+    int strong;
+    EndgameFn fn;
+} ENDGAMES[] = {
+    {K2, WHITE, eg_draw},
+    {K2 + MAT_KEY(WN), WHITE, eg_draw},
+    {K2 + MAT_KEY(BN), BLACK, eg_draw},
+    {K2 + MAT_KEY(WB), WHITE, eg_draw},
+    {K2 + MAT_KEY(BB), BLACK, eg_draw},
+    {K2 + 2 * MAT_KEY(WN), WHITE, eg_draw},
+    {K2 + 2 * MAT_KEY(BN), BLACK, eg_draw},
+    {K2 + MAT_KEY(WP), WHITE, eg_kpk},
+    {K2 + MAT_KEY(BP), BLACK, eg_kpk},
+    {K2 + MAT_KEY(WB) + MAT_KEY(WN), WHITE, eg_kbnk},
+    {K2 + MAT_KEY(BB) + MAT_KEY(BN), BLACK, eg_kbnk},
+};
+#define N_ENDGAMES ((int)(sizeof(ENDGAMES) / sizeof(ENDGAMES[0])))
+
+EndgameResult endgame_eval(const Position *pos, int *score) {
+    if (popcount64(pos->occ) > ENDGAME_MAX_PIECES) return ENDGAME_NONE;
+    int strong = -1;
+    EndgameFn fn = NULL;
+    for (int i = 0; i < N_ENDGAMES && !fn; ++i) {
+        if (ENDGAMES[i].key != pos->mat_key) continue;
+        strong = ENDGAMES[i].strong;
+        fn = ENDGAMES[i].fn;
+    }
+    if (!fn) {
+        /* Bare king against a queen or rook and anything else without pawns. */
+        for (int side = WHITE; side <= BLACK && !fn; ++side) {
+            Piece pawn = side == WHITE ? WP : BP;
+            U64 heavy = pos->bb_piece[(side == WHITE ? WR : BR) - 1] | pos->bb_piece[(side == WHITE ? WQ : BQ) - 1];
+            if (pos->bb_color[side ^ 1] != (1ULL << pos->king_sq[side ^ 1])) continue;
+            if (!heavy || pos->bb_piece[pawn - 1]) continue;
+            strong = side;
+            fn = eg_kxk;
+        }
+    }
+    if (!fn) return ENDGAME_NONE;
+    EndgameResult r = fn(pos, strong, score);
+    if (pos->side != strong) *score = -*score;
+    return r;
+}
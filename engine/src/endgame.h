@@ -0,0 +1,13 @@
+#pragma once
+#include "position.h"
+
+#define KNOWN_WIN 10000
+#define ENDGAME_MAX_PIECES 5
+
+typedef enum {
+    ENDGAME_NONE = 0,
+    ENDGAME_SCORE,
+    ENDGAME_EXACT
+} EndgameResult;
+
+EndgameResult endgame_eval(const Position *pos, int *score);
@@ -1,151 +1,226 @@
+#include <string.h>
 #include "eval.h"
 #include "tables.h"
+#include "eval_weights.h"
+#include "endgame.h"
 
-static const int PIECE_VALUE[13] = {
-    0, 100, 320, 330, 500, 900, 20000,
-    100, 320, 330, 500, 900, 20000
-};
-
-static const int PST_PAWN[64] = {
-      0,   0,   0,   0,   0,   0,   0,   0,
-     50,  50,  50,  50,  50,  50,  50,  50,
-     10,  10,  20,  30,  30,  20,  10,  10,
-      5,   5,  10,  25,  25,  10,   5,   5,
-      0,   0,   0,  20,  20,   0,   0,   0,
-      5,  -5, -10,   0,   0, -10,  -5,   5,
-      5,  10,  10, -20, -20,  10,  10,   5,
-      0,   0,   0,   0,   0,   0,   0,   0
-};
+static int mirror_sq(int sq) {
+    int file = sq & 7;
+    int rank = sq >> 3;
+    return (7 - rank) * 8 + file;
+}
 
-static const int PST_KNIGHT[64] = {
-    -50, -40, -30, -30, -30, -30, -40, -50,
-    -40, -20,   0,   0,   0,   0, -20, -40,
-    -30,   0,  10,  15,  15,  10,   0, -30,
-    -30,   5,  15,  20,  20,  15,   5, -30,
-    -30,   0,  15,  20,  20,  15,   0, -30,
-    -30,   5,  10,  15,  15,  10,   5, -30,
-    -40, -20,   0,   5,   5,   0, -20, -40,
-    -50, -40, -30, -30, -30, -30, -40, -50
-};
+int32_t PSQT[13 * 64];
 
-static const int PST_BISHOP[64] = {
-    -20, -10, -10, -10, -10, -10, -10, -20,
-    -10,   0,   0,   0,   0,   0,   0, -10,
-    -10,   0,   5,  10,  10,   5,   0, -10,
-    -10,   5,   5,  10,  10,   5,   5, -10,
-    -10,   0,  10,  10,  10,  10,   0, -10,
-    -10,  10,  10,  10,  10,  10,  10, -10,
-    -10,   5,   0,   0,   0,   0,   5, -10,
-    -20, -10, -10, -10, -10, -10, -10, -20
-};
+void eval_init(void) {
+    const int *const pst[6] = {PST_PAWN, PST_KNIGHT, PST_BISHOP, PST_ROOK, PST_QUEEN, PST_KING};
+    memset(PSQT, 0, sizeof(PSQT));
+    for (int t = 0; t < 6; ++t) {
+        for (int sq = 0; sq < 64; ++sq) {
+            PSQT[(WP + t) * 64 + sq] = PIECE_VALUE[WP + t] + pst[t][sq];
+            PSQT[(BP + t) * 64 + sq] = -(PIECE_VALUE[BP + t] + pst[t][mirror_sq(sq)]);
+        }
+    }
+}
 
-static const int PST_ROOK[64] = {
-     0,   0,   0,   0,   0,   0,   0,   0,
-     5,  10,  10,  10,  10,  10,  10,   5,
-    -5,   0,   0,   0,   0,   0,   0,  -5,
-    -5,   0,   0,   0,   0,   0,   0,  -5,
-    -5,   0,   0,   0,   0,   0,   0,  -5,
-    -5,   0,   0,   0,   0,   0,   0,  -5,
-    -5,   0,   0,   0,   0,   0,   0,  -5,
-     0,   0,   0,   5,   5,   0,   0,   0
-};
+#define FILE_A 0x0101010101010101ULL
+#define FILE_H (FILE_A << 7)
 
-static const int PST_QUEEN[64] = {
-    -20, -10, -10,  -5,  -5, -10, -10, -20,
-    -10,   0,   0,   0,   0,   0,   0, -10,
-    -10,   0,   5,   5,   5,   5,   0, -10,
-     -5,   0,   5,   5,   5,   5,   0,  -5,
-      0,   0,   5,   5,   5,   5,   0,  -5,
-    -10,   5,   5,   5,   5,   5,   0, -10,
-    -10,   0,   5,   0,   0,   0,   0, -10,
-    -20, -10, -10,  -5,  -5, -10, -10, -20
+static const int ATTACK_WEIGHTS[EVAL_ATTACK_TERMS] = {
+    MOBILITY_KNIGHT, MOBILITY_BISHOP, MOBILITY_ROOK, MOBILITY_QUEEN, KING_ZONE_ATTACK,
+    PINNED_PENALTY, HANGING_PENALTY, THREAT_BY_PAWN, THREAT_BY_MINOR
 };
 
-static const int PST_KING[64] = {
-    -30, -40, -40, -50, -50, -40, -40, -30,
-    -30, -40, -40, -50, -50, -40, -40, -30,
-    -30, -40, -40, -50, -50, -40, -40, -30,
-    -30, -40, -40, -50, -50, -40, -40, -30,
-    -20, -30, -30, -40, -40, -30, -30, -20,
-    -10, -20, -20, -20, -20, -20, -20, -10,
-     20,  20,   0,   0,   0,   0,  20,  20,
-     20,  30,  10,   0,   0,  10,  30,  20
-};
+static U64 piece_attacks(int type, int sq, U64 occ) {
+    switch (type) {
+        case 1: return KNIGHT_ATTACKS[sq];
+        case 2: return bishop_attacks(sq, occ);
+        case 3: return rook_attacks(sq, occ);
+        default: return bishop_attacks(sq, occ) | rook_attacks(sq, occ);
+    }
+}
 
-static int mirror_sq(int sq) {
-    int file = sq & 7;
-    int rank = sq >> 3;
-    return (7 - rank) * 8 + file;
+static void build_attacks(const Position *pos, EvalAttacks *att) {
+    memset(att, 0, sizeof(*att));
+    for (int c = WHITE; c <= BLACK; ++c) {
+        U64 pawns = pos->bb_piece[(c == WHITE ? WP : BP) - 1];
+        U64 left = c == WHITE ? (pawns & ~FILE_A) << 7 : (pawns & ~FILE_A) >> 9;
+        U64 right = c == WHITE ? (pawns & ~FILE_H) << 9 : (pawns & ~FILE_H) >> 7;
+        att->by_type[c][0] = left | right;
+        att->all[c] = left | right;
+        att->twice[c] = left & right;
+    }
+    for (int c = WHITE; c <= BLACK; ++c) {
+        int them = c ^ 1;
+        U64 safe = ~pos->bb_color[c] & ~att->by_type[them][0];
+        U64 zone = KING_ATTACKS[pos->king_sq[them]] | (1ULL << pos->king_sq[them]);
+        int pawn = c == WHITE ? WP : BP;
+        for (int t = 1; t <= 4; ++t) {
+            for (U64 b = pos->bb_piece[pawn + t - 1]; b; b &= b - 1) {
+                U64 a = piece_attacks(t, lsb_index(b), pos->occ);
+                att->by_type[c][t] |= a;
+                att->twice[c] |= att->all[c] & a;
+                att->all[c] |= a;
+                att->mobility[c][t - 1] += popcount64(a & safe);
+                att->king_zone[c] += popcount64(a & zone);
+            }
+        }
+        U64 k = KING_ATTACKS[pos->king_sq[c]];
+        att->by_type[c][5] = k;
+        att->twice[c] |= att->all[c] & k;
+        att->all[c] |= k;
+    }
 }
 
-static int eval_pst(Piece p, int sq) {
-    switch (p) {
-        case WP: return PST_PAWN[sq];
-        case BP: return PST_PAWN[mirror_sq(sq)];
-        case WN: return PST_KNIGHT[sq];
-        case BN: return PST_KNIGHT[mirror_sq(sq)];
-        case WB: return PST_BISHOP[sq];
-        case BB: return PST_BISHOP[mirror_sq(sq)];
-        case WR: return PST_ROOK[sq];
-        case BR: return PST_ROOK[mirror_sq(sq)];
-        case WQ: return PST_QUEEN[sq];
-        case BQ: return PST_QUEEN[mirror_sq(sq)];
-        case WK: return PST_KING[sq];
-        case BK: return PST_KING[mirror_sq(sq)];
-        default: return 0;
+/* White-minus-black counts for each attack term, negated for penalties so every weight adds. */
+static void attack_counts(const Position *pos, const EvalAttacks *att, int *counts) {
+    const State *st = pos_state(pos);
+    memset(counts, 0, EVAL_ATTACK_TERMS * sizeof(int));
+    for (int c = WHITE; c <= BLACK; ++c) {
+        int them = c ^ 1;
+        int sign = c == WHITE ? 1 : -1;
+        int pawn = c == WHITE ? WP : BP;
+        U64 minors = pos->bb_piece[pawn] | pos->bb_piece[pawn + 1];
+        U64 majors = pos->bb_piece[pawn + 2] | pos->bb_piece[pawn + 3];
+        U64 pieces = minors | majors;
+        for (int t = 0; t < 4; ++t) counts[t] += sign * att->mobility[c][t];
+        counts[4] += sign * att->king_zone[c];
+        counts[5] -= sign * popcount64(st->blockers[c] & pos->bb_color[c]);
+        counts[6] -= sign * popcount64(pieces & att->all[them] & ~att->all[c]);
+        counts[7] -= sign * popcount64(pieces & att->by_type[them][0]);
+        counts[8] -= sign * popcount64(majors & (att->by_type[them][1] | att->by_type[them][2]));
     }
 }
 
+int eval_attack_terms(const Position *pos, EvalAttacks *att) {
+    int counts[EVAL_ATTACK_TERMS];
+    build_attacks(pos, att);
+    attack_counts(pos, att, counts);
+    int score = 0;
+    for (int i = 0; i < EVAL_ATTACK_TERMS; ++i) score += ATTACK_WEIGHTS[i] * counts[i];
+    return score;
+}
+
+static int pawn_terms(U64 pawns) {
+    U64 fill = pawns | (pawns >> 32);
+    fill |= fill >> 16;
+    fill |= fill >> 8;
+    unsigned files = (unsigned)(fill & 0xFF);
+    unsigned isolated = files & ~((files << 1) | (files >> 1));
+    int doubled = popcount64(pawns) - popcount64(files);
+    return -DOUBLED_PAWN_PENALTY * doubled - ISOLATED_PAWN_PENALTY * popcount64(isolated);
+}
+
+/* Bishop pair, pawn structure and king squares, white-relative. */
+int eval_structure(const Position *pos) {
+    int score = 0;
+    if (popcount64(pos->bb_piece[WB - 1]) >= 2) score += BISHOP_PAIR_BONUS;
+    if (popcount64(pos->bb_piece[BB - 1]) >= 2) score -= BISHOP_PAIR_BONUS;
+    score += pawn_terms(pos->bb_piece[WP - 1]);
+    score -= pawn_terms(pos->bb_piece[BP - 1]);
+    int kw = popcount64(KNIGHT_ATTACKS[pos->king_sq[WHITE]]);
+    int kb = popcount64(KNIGHT_ATTACKS[pos->king_sq[BLACK]]);
+    return score + KING_KNIGHT_SQUARES * (kw - kb);
+}
+
 int eval(const Position *pos) {
+    EvalAttacks att;
+    return eval_full(pos, &att);
+}
+
+int eval_full(const Position *pos, EvalAttacks *att) {
+    int score = eval_attack_terms(pos, att);
+    int eg_score = 0;
+    if (endgame_eval(pos, &eg_score) != ENDGAME_NONE) return eg_score;
+    score += pos->psq + eval_structure(pos);
+    return (pos->side == WHITE) ? score : -score;
+}
+
+int eval_lazy(const Position *pos, int alpha, int beta, EvalAttacks *att, bool *full) {
+    *full = true;
     int score = 0;
-    int white_bishops = 0;
-    int black_bishops = 0;
+    if (endgame_eval(pos, &score) != ENDGAME_NONE) {
+        eval_attack_terms(pos, att);
+        return score;
+    }
+    int base = pos->psq + eval_structure(pos);
+    score = pos->side == WHITE ? base : -base;
+    if (score - EVAL_LAZY_MARGIN >= beta || score + EVAL_LAZY_MARGIN <= alpha) {
+        *full = false;
+        return score;
+    }
+    score = base + eval_attack_terms(pos, att);
+    return (pos->side == WHITE) ? score : -score;
+}
 
-    int white_pawns_file[8] = {0};
-    int black_pawns_file[8] = {0};
+static const int *const PST_TABLES[6] = {
+    PST_PAWN, PST_KNIGHT, PST_BISHOP, PST_ROOK, PST_QUEEN, PST_KING
+};
+
+void eval_get_weights(int *w) {
+    for (int t = 0; t < 5; ++t) w[EVAL_F_PIECE + t] = PIECE_VALUE[WP + t];
+    for (int t = 0; t < 6; ++t) {
+        for (int sq = 0; sq < 64; ++sq) w[EVAL_F_PST + t * 64 + sq] = PST_TABLES[t][sq];
+    }
+    w[EVAL_F_BISHOP_PAIR] = BISHOP_PAIR_BONUS;
+    w[EVAL_F_DOUBLED_PAWN] = DOUBLED_PAWN_PENALTY;
+    w[EVAL_F_ISOLATED_PAWN] = ISOLATED_PAWN_PENALTY;
+    w[EVAL_F_KING_KNIGHT] = KING_KNIGHT_SQUARES;
+    for (int i = 0; i < EVAL_ATTACK_TERMS; ++i) w[EVAL_F_MOBILITY + i] = ATTACK_WEIGHTS[i];
+}
 
+int eval_features(const Position *pos, uint16_t *index, int8_t *coef) {
+    int n = 0;
+    int counts[5] = {0};
+    int pawns_file[2][8] = {{0}};
     for (int sq = 0; sq < 64; ++sq) {
         Piece p = pos->piece_on[sq];
         if (p == EMPTY) continue;
-        int val = PIECE_VALUE[p];
-        int pst = eval_pst(p, sq);
-        if (piece_color(p) == WHITE) {
-            score += val + pst;
-        } else {
-            score -= val + pst;
-        }
-        if (p == WB) white_bishops++;
-        if (p == BB) black_bishops++;
-        if (p == WP) white_pawns_file[sq & 7]++;
-        if (p == BP) black_pawns_file[sq & 7]++;
+        int white = piece_color(p) == WHITE;
+        int type = ((int)p - 1) % 6;
+        if (type < 5) counts[type] += white ? 1 : -1;
+        index[n] = (uint16_t)(EVAL_F_PST + type * 64 + (white ? sq : mirror_sq(sq)));
+        coef[n++] = (int8_t)(white ? 1 : -1);
+        if (type == 0) pawns_file[white ? WHITE : BLACK][sq & 7]++;
     }
-
-    if (white_bishops >= 2) score += 30;
-    if (black_bishops >= 2) score -= 30;
-
-    for (int file = 0; file < 8; ++file) {
-        if (white_pawns_file[file] > 1) score -= 15 * (white_pawns_file[file] - 1);
-        if (black_pawns_file[file] > 1) score += 15 * (black_pawns_file[file] - 1);
+    for (int t = 0; t < 5; ++t) {
+        if (!counts[t]) continue;
+        index[n] = (uint16_t)(EVAL_F_PIECE + t);
+        coef[n++] = (int8_t)counts[t];
     }
 
-    for (int file = 0; file < 8; ++file) {
-        if (white_pawns_file[file] > 0) {
-            int adj = 0;
-            if (file > 0) adj += white_pawns_file[file - 1];
-            if (file < 7) adj += white_pawns_file[file + 1];
-            if (adj == 0) score -= 10;
-        }
-        if (black_pawns_file[file] > 0) {
-            int adj = 0;
-            if (file > 0) adj += black_pawns_file[file - 1];
-            if (file < 7) adj += black_pawns_file[file + 1];
-            if (adj == 0) score += 10;
+    int pair = (popcount64(pos->bb_piece[WB - 1]) >= 2) - (popcount64(pos->bb_piece[BB - 1]) >= 2);
+    int doubled = 0;
+    int isolated = 0;
+    for (int c = WHITE; c <= BLACK; ++c) {
+        int sign = c == WHITE ? -1 : 1;
+        for (int file = 0; file < 8; ++file) {
+            int cnt = pawns_file[c][file];
+            if (cnt > 1) doubled += sign * (cnt - 1);
+            int adj = (file > 0 ? pawns_file[c][file - 1] : 0) + (file < 7 ? pawns_file[c][file + 1] : 0);
+            if (cnt > 0 && adj == 0) isolated += sign;
         }
     }
-
-    int mobility_white = popcount64(KNIGHT_ATTACKS[pos->king_sq[WHITE]]);
-    int mobility_black = popcount64(KNIGHT_ATTACKS[pos->king_sq[BLACK]]);
-    score += (mobility_white - mobility_black);
-
-    return (pos->side == WHITE) ? score : -score;
+    int king = popcount64(KNIGHT_ATTACKS[pos->king_sq[WHITE]]) - popcount64(KNIGHT_ATTACKS[pos->king_sq[BLACK]]);
+    const int extra[4][2] = {
+        {EVAL_F_BISHOP_PAIR, pair},
+        {EVAL_F_DOUBLED_PAWN, doubled},
+        {EVAL_F_ISOLATED_PAWN, isolated},
+        {EVAL_F_KING_KNIGHT, king}
+    };
+    for (int i = 0; i < 4; ++i) {
+        if (!extra[i][1]) continue;
+        index[n] = (uint16_t)extra[i][0];
+        coef[n++] = (int8_t)extra[i][1];
+    }
+    EvalAttacks att;
+    int terms[EVAL_ATTACK_TERMS];
+    build_attacks(pos, &att);
+    attack_counts(pos, &att, terms);
+    for (int i = 0; i < EVAL_ATTACK_TERMS; ++i) {
+        if (!terms[i]) continue;
+        index[n] = (uint16_t)(EVAL_F_MOBILITY + i);
+        coef[n++] = (int8_t)terms[i];
+    }
+    return n;
 }
@@ -1,4 +1,48 @@
 #pragma once
 #include "position.h"
 
+#define EVAL_MAX_FEATURES 64
+
+enum {
+    EVAL_F_PIECE = 0,
+    EVAL_F_PST = EVAL_F_PIECE + 5,
+    EVAL_F_BISHOP_PAIR = EVAL_F_PST + 6 * 64,
+    EVAL_F_DOUBLED_PAWN,
+    EVAL_F_ISOLATED_PAWN,
+    EVAL_F_KING_KNIGHT,
+    EVAL_F_MOBILITY,
+    EVAL_F_KING_ZONE = EVAL_F_MOBILITY + 4,
+    EVAL_F_PINNED,
+    EVAL_F_HANGING,
+    EVAL_F_THREAT_PAWN,
+    EVAL_F_THREAT_MINOR,
+    EVAL_N_FEATURES
+};
+
+#define EVAL_ATTACK_TERMS (EVAL_N_FEATURES - EVAL_F_MOBILITY)
+
+/* eval_lazy() skips the attack terms when material and tables alone are this far outside the window. */
+#define EVAL_LAZY_MARGIN 300
+
+/* Attack maps built once per evaluation, indexed [side][piece type]. Search reuses the maps of
+ * the node it evaluated instead of generating attacks again. */
+typedef struct {
+    U64 by_type[2][6];
+    U64 all[2];
+    U64 twice[2];
+    int mobility[2][4];
+    int king_zone[2];
+} EvalAttacks;
+
+/* Material plus piece-square value of each piece on each square, white-relative, indexed
+ * piece * 64 + square. make_move() keeps Position.psq as the sum over the board. */
+extern int32_t PSQT[13 * 64];
+
+void eval_init(void);
 int eval(const Position *pos);
+int eval_structure(const Position *pos);
+int eval_full(const Position *pos, EvalAttacks *att);
+int eval_attack_terms(const Position *pos, EvalAttacks *att);
+int eval_lazy(const Position *pos, int alpha, int beta, EvalAttacks *att, bool *full);
+int eval_features(const Position *pos, uint16_t *index, int8_t *coef);
+void eval_get_weights(int *w);
@@ -0,0 +1,21 @@
+#include <pthread.h>
+#include "init.h"
+#include "tables.h"
+#include "zobrist.h"
+#include "eval.h"
+#include "bitbase.h"
+
+#define ZOBRIST_SEED 20260202ULL
+
+static pthread_once_t INIT_ONCE = PTHREAD_ONCE_INIT;
+
+static void init_tables_once(void) {
+    zobrist_init(ZOBRIST_SEED);
+    tables_init();
+    eval_init();
+    bitbase_init();
+}
+
+void engine_init(void) {
+    pthread_once(&INIT_ONCE, init_tables_once);
+}
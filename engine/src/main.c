@@ -1,6 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "uci.h"
+#include "chessv2.h"
+#include "perftsuite.h"
+#include "booksuite.h"
+#include "tbsuite.h"
+#include "nodessuite.h"
+#include "bench.h"
+#include "analyze.h"
+#include "datagen.h"
+#include "tune.h"
 
-int main(void) {
+static int run_perft_suite(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s perftsuite <file.epd> [max_depth] [threads]\n", argv[0]);
+        return 2;
+    }
+    ChessEngine *eng = chess_engine_new(1);
+    if (!eng) return 2;
+    if (argc > 4) chess_set_option(eng, "Threads", argv[4]);
+    int failures = perft_suite_run(eng, argv[2], argc > 3 ? atoi(argv[3]) : 0);
+    chess_engine_free(eng);
+    return failures == 0 ? 0 : 1;
+}
+
+static int run_book_suite(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s booksuite <book.bin> <file.epd>\n", argv[0]);
+        return 2;
+    }
+    ChessEngine *eng = chess_engine_new(1);
+    if (!eng) return 2;
+    int failures = book_suite_run(eng, argv[2], argv[3]);
+    chess_engine_free(eng);
+    return failures == 0 ? 0 : 1;
+}
+
+static int run_tb_suite(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s tbsuite <syzygy_dir> <file.epd>\n", argv[0]);
+        return 2;
+    }
+    ChessEngine *eng = chess_engine_new(1);
+    if (!eng) return 2;
+    int failures = tb_suite_run(eng, argv[2], argv[3]);
+    chess_engine_free(eng);
+    return failures == 0 ? 0 : 1;
+}
+
+static int run_nodes_suite(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s nodessuite <file.epd>\n", argv[0]);
+        return 2;
+    }
+    ChessEngine *eng = chess_engine_new(1);
+    if (!eng) return 2;
+    int failures = nodes_suite_run(eng, argv[2]);
+    chess_engine_free(eng);
+    return failures == 0 ? 0 : 1;
+}
+
+static int run_bench(int argc, char **argv) {
+    int hash = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_HASH;
+    int threads = argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_THREADS;
+    int depth = argc > 4 ? atoi(argv[4]) : BENCH_DEFAULT_DEPTH;
+    BenchResult res;
+    bench_run((size_t)(hash > 0 ? hash : 1), threads > 0 ? threads : 1, depth > 0 ? depth : 1, &res);
+    bench_print(&res);
+    return 0;
+}
+
+static int run_analyze(int argc, char **argv) {
+    AnalyzeOptions opt = {ANALYZE_DEFAULT_DEPTH, 0, 0, 1, ANALYZE_DEFAULT_HASH};
+    const char *in_path = NULL;
+    const char *out_path = NULL;
+    bool depth_set = false;
+    for (int i = 2; i < argc; ++i) {
+        if (!strcmp(argv[i], "--depth") && i + 1 < argc) {
+            opt.depth = atoi(argv[++i]);
+            depth_set = true;
+        } else if (!strcmp(argv[i], "--movetime") && i + 1 < argc) {
+            opt.movetime_ms = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--nodes") && i + 1 < argc) {
+            opt.nodes = strtoull(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            opt.threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--hash") && i + 1 < argc) {
+            int mb = atoi(argv[++i]);
+            opt.hash_mb = (size_t)(mb > 0 ? mb : 1);
+        } else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (argv[i][0] != '-' || !strcmp(argv[i], "-")) {
+            in_path = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s analyze [--depth N] [--movetime MS] [--nodes N] [--threads N] [--hash MB] "
+                            "[--out file] [file.epd|-]\n", argv[0]);
+            return 2;
+        }
+    }
+    if ((opt.movetime_ms > 0 || opt.nodes > 0) && !depth_set) opt.depth = 0;
+
+    FILE *in = stdin;
+    FILE *out = stdout;
+    if (in_path && strcmp(in_path, "-") && !(in = fopen(in_path, "r"))) {
+        fprintf(stderr, "analyze: cannot open %s\n", in_path);
+        return 2;
+    }
+    if (out_path && !(out = fopen(out_path, "w"))) {
+        fprintf(stderr, "analyze: cannot open %s\n", out_path);
+        if (in != stdin) fclose(in);
+        return 2;
+    }
+
+    AnalyzeReport rep;
+    analyze_run(in, out, &opt, &rep);
+    if (in != stdin) fclose(in);
+    if (out != stdout) fclose(out);
+
+    uint64_t ms = rep.time_ms ? rep.time_ms : 1;
+    fprintf(stderr, "analyze: %llu positions (%llu errors) nodes %llu time %llu ms, %.1f pos/s, %llu nps\n",
+            (unsigned long long)rep.positions, (unsigned long long)rep.errors,
+            (unsigned long long)rep.nodes, (unsigned long long)rep.time_ms,
+            (double)rep.positions * 1000.0 / (double)ms,
+            (unsigned long long)(rep.nodes * 1000u / ms));
+    return rep.errors ? 1 : 0;
+}
+
+static int datagen_usage(const char *argv0) {
+    fprintf(stderr, "usage: %s datagen --out file.bin [--games N] [--nodes N] [--threads N] "
+                    "[--random-plies N] [--seed S] [--hash MB]\n"
+                    "       %s datagen --dump file.bin [--limit N]\n", argv0, argv0);
+    return 2;
+}
+
+static int run_datagen(int argc, char **argv) {
+    DatagenOptions opt = {NULL, 1000, 5000, 1, 8, 1, 16};
+    const char *dump = NULL;
+    uint64_t limit = 0;
+    if (argc % 2) return datagen_usage(argv[0]);
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const char *a = argv[i];
+        const char *v = argv[i + 1];
+        if (!strcmp(a, "--out")) opt.out_path = v;
+        else if (!strcmp(a, "--games")) opt.games = strtoull(v, NULL, 10);
+        else if (!strcmp(a, "--nodes")) opt.nodes = strtoull(v, NULL, 10);
+        else if (!strcmp(a, "--threads")) opt.threads = atoi(v);
+        else if (!strcmp(a, "--random-plies")) opt.random_plies = atoi(v);
+        else if (!strcmp(a, "--seed")) opt.seed = strtoull(v, NULL, 10);
+        else if (!strcmp(a, "--hash")) opt.hash_mb = (size_t)(atoi(v) > 0 ? atoi(v) : 1);
+        else if (!strcmp(a, "--dump")) dump = v;
+        else if (!strcmp(a, "--limit")) limit = strtoull(v, NULL, 10);
+        else return datagen_usage(argv[0]);
+    }
+    if (dump) return datagen_dump(dump, limit) == 0 ? 0 : 1;
+    if (!opt.out_path || !opt.nodes) return datagen_usage(argv[0]);
+    DatagenReport rep;
+    if (!datagen_run(&opt, &rep)) {
+        fprintf(stderr, "datagen: cannot write %s\n", opt.out_path);
+        return 1;
+    }
+    uint64_t ms = rep.time_ms ? rep.time_ms : 1;
+    fprintf(stderr, "datagen: %llu games %llu positions time %llu ms, %llu pos/s\n",
+            (unsigned long long)rep.games, (unsigned long long)rep.positions,
+            (unsigned long long)rep.time_ms, (unsigned long long)(rep.positions * 1000u / ms));
+    return 0;
+}
+
+static int tune_usage(const char *argv0) {
+    fprintf(stderr, "usage: %s tune <data.epd|data.bin> [--epochs N] [--lr X] [--threads N] "
+                    "[--limit N] [--write src/eval_weights.h]\n", argv0);
+    return 2;
+}
+
+static int run_tune(int argc, char **argv) {
+    TuneOptions opt = {NULL, NULL, 200, 1.0, 1, 0};
+    for (int i = 2; i < argc; ++i) {
+        bool more = i + 1 < argc;
+        if (!strcmp(argv[i], "--epochs") && more) opt.epochs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--lr") && more) opt.lr = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && more) opt.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--limit") && more) opt.limit = strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--write") && more) opt.write_path = argv[++i];
+        else if (argv[i][0] != '-' && !opt.data_path) opt.data_path = argv[i];
+        else return tune_usage(argv[0]);
+    }
+    if (!opt.data_path) return tune_usage(argv[0]);
+    return tune_run(&opt);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && !strcmp(argv[1], "perftsuite")) return run_perft_suite(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "booksuite")) return run_book_suite(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "tbsuite")) return run_tb_suite(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "nodessuite")) return run_nodes_suite(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "bench")) return run_bench(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "analyze")) return run_analyze(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "datagen")) return run_datagen(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "tune")) return run_tune(argc, argv);
     uci_loop();
     return 0;
 }
@@ -1,20 +1,28 @@
 #include "make.h"
 #include "attack.h"
+#include "tables.h"
 #include "zobrist.h"
+#include "stats.h"
+#include "eval.h"
 
 static inline void remove_piece(Position *pos, Piece p, int sq) {
     pos->bb_piece[p - 1] &= ~(1ULL << sq);
     pos->piece_on[sq] = EMPTY;
     pos->key ^= Z_PIECE[p - 1][sq];
+    pos->mat_key -= MAT_KEY(p);
+    pos->psq -= PSQT[(int)p * 64 + sq];
 }
 
 static inline void add_piece(Position *pos, Piece p, int sq) {
     pos->bb_piece[p - 1] |= 1ULL << sq;
     pos->piece_on[sq] = p;
     pos->key ^= Z_PIECE[p - 1][sq];
+    pos->mat_key += MAT_KEY(p);
+    pos->psq += PSQT[(int)p * 64 + sq];
 }
 
 bool in_check(const Position *pos, int side) {
+    if (side == pos->side) return pos_state(pos)->checkers != 0;
     int ksq = pos->king_sq[side];
     return is_square_attacked(pos, ksq, side ^ 1);
 }
@@ -56,6 +64,16 @@ bool make_move(Position *pos, Move mv) {
     Piece cap = M_CAP(mv);
     uint32_t flags = M_FLAGS(mv);
 
+    /* Out of check, only king moves and en passant can expose the king in ways the cached
+     * blockers miss; any other move is legal unless it walks a pinned piece off its line. */
+    int us = pos->side;
+    bool full_test = st->checkers || pc == WK || pc == BK || (flags & FLAG_EP);
+    if (!full_test && (st->blockers[us] & (1ULL << from)) && !(LINE[from][pos->king_sq[us]] & (1ULL << to))) {
+        STAT_INC(moves_made);
+        STAT_INC(moves_illegal);
+        return false;
+    }
+
     if (pos->ep_sq >= 0) {
         pos->key ^= Z_EPFILE[pos->ep_sq & 7];
     } else {
@@ -125,10 +143,20 @@ bool make_move(Position *pos, Move mv) {
 
     pos_update_occupancy(pos);
 
-    if (in_check(pos, pos->side ^ 1)) {
+    STAT_INC(moves_made);
+    if (full_test && in_check(pos, us)) {
+        STAT_INC(moves_illegal);
         undo_move(pos, mv);
         return false;
     }
+    /* The mover's checks come from the cached check squares unless the move can uncover one. */
+    State *next = &pos->st[pos->ply];
+    if ((flags & (FLAG_EP | FLAG_CASTLE | FLAG_PROMO)) || (st->blockers[pos->side] & (1ULL << from))) {
+        next->checkers = attackers_to(pos, pos->king_sq[pos->side], pos->occ) & pos->bb_color[us];
+    } else {
+        next->checkers = st->check_sq[(pc - 1) % 6] & (1ULL << to);
+    }
+    pos_update_pins(pos);
     return true;
 }
 
@@ -0,0 +1,184 @@
+#include <stdlib.h>
+#include <string.h>
+#include "mate.h"
+#include "movegen.h"
+#include "make.h"
+#include "time.h"
+
+/* Depth-first proof-number search. phi/delta are from the side to move: phi is the proof
+ * number of "side to move wins", delta the other, so OR and AND nodes share one code path. */
+
+#define DFPN_INF 100000000u
+
+typedef struct {
+    Move m[MAX_MOVES];
+    uint64_t k[MAX_MOVES];
+    int n;
+} Children;
+
+bool mate_init(MateSearch *ms, size_t mb) {
+    memset(ms, 0, sizeof(*ms));
+    size_t n = mb * 1024u * 1024u / sizeof(MateEntry);
+    size_t pow2 = 1;
+    while (pow2 * 2 <= n) pow2 <<= 1;
+    ms->t = (MateEntry *)calloc(pow2, sizeof(MateEntry));
+    if (!ms->t) return false;
+    ms->mask = (uint64_t)(pow2 - 1);
+    return true;
+}
+
+void mate_free(MateSearch *ms) {
+    free(ms->t);
+    memset(ms, 0, sizeof(*ms));
+}
+
+static uint64_t slot_key(uint64_t key, int plies) {
+    return key ^ ((uint64_t)(plies + 1) * UINT64_C(0x9e3779b97f4a7c15));
+}
+
+static void lookup(const MateSearch *ms, uint64_t k, uint32_t *phi, uint32_t *delta) {
+    const MateEntry *e = &ms->t[k & ms->mask];
+    if (e->key == k) {
+        *phi = e->phi;
+        *delta = e->delta;
+    } else {
+        *phi = 1;
+        *delta = 1;
+    }
+}
+
+static void store(MateSearch *ms, uint64_t k, uint32_t phi, uint32_t delta) {
+    MateEntry *e = &ms->t[k & ms->mask];
+    e->key = k;
+    e->phi = phi;
+    e->delta = delta;
+}
+
+/* The attacker only considers checking moves; the defender considers every legal reply. */
+static void gen_children(Position *pos, bool attacker, int plies, Children *c) {
+    MoveList list;
+    gen_pseudo_legal(pos, &list);
+    c->n = 0;
+    for (int i = 0; i < list.n; ++i) {
+        Move mv = list.m[i];
+        if (attacker && !gives_check(pos, mv)) continue;
+        if (!make_move(pos, mv)) continue;
+        c->m[c->n] = mv;
+        c->k[c->n++] = slot_key(pos->key, plies - 1);
+        undo_move(pos, mv);
+    }
+}
+
+static bool terminal(Position *pos, bool attacker, int plies, const Children *c,
+                     uint32_t *phi, uint32_t *delta) {
+    bool lost;
+    if (attacker) {
+        if (plies > 0 && c->n > 0) return false;
+        lost = true;
+    } else if (c->n == 0) {
+        lost = in_check(pos, pos->side);
+    } else if (plies <= 0) {
+        lost = false;
+    } else {
+        return false;
+    }
+    *phi = lost ? DFPN_INF : 0;
+    *delta = lost ? 0 : DFPN_INF;
+    return true;
+}
+
+static void mid(MateSearch *ms, Position *pos, int plies, bool attacker, uint32_t th_phi, uint32_t th_delta) {
+    ms->nodes++;
+    if ((ms->nodes & 1023) == 0 && ms->deadline_ms && now_ms() >= ms->deadline_ms) ms->aborted = true;
+    if (ms->max_nodes && ms->nodes >= ms->max_nodes) ms->aborted = true;
+
+    uint64_t key = slot_key(pos->key, plies);
+    Children c;
+    gen_children(pos, attacker, plies, &c);
+    uint32_t phi = 0;
+    uint32_t delta = 0;
+    if (terminal(pos, attacker, plies, &c, &phi, &delta)) {
+        store(ms, key, phi, delta);
+        return;
+    }
+
+    for (;;) {
+        int best = 0;
+        uint32_t best_phi = 0;
+        uint32_t delta2 = DFPN_INF;
+        uint64_t sum = 0;
+        phi = DFPN_INF;
+        for (int i = 0; i < c.n; ++i) {
+            uint32_t cphi;
+            uint32_t cdelta;
+            lookup(ms, c.k[i], &cphi, &cdelta);
+            sum += cphi;
+            if (cdelta < phi) {
+                delta2 = phi;
+                phi = cdelta;
+                best = i;
+                best_phi = cphi;
+            } else if (cdelta < delta2) {
+                delta2 = cdelta;
+            }
+        }
+        delta = sum >= DFPN_INF ? DFPN_INF : (uint32_t)sum;
+        if (phi >= th_phi || delta >= th_delta || ms->aborted) break;
+
+        uint64_t child_phi = (uint64_t)th_delta - delta + best_phi;
+        uint64_t child_delta = (uint64_t)delta2 + 1 < th_phi ? (uint64_t)delta2 + 1 : th_phi;
+        make_move(pos, c.m[best]);
+        mid(ms, pos, plies - 1, !attacker, child_phi >= DFPN_INF ? DFPN_INF : (uint32_t)child_phi,
+            child_delta >= DFPN_INF ? DFPN_INF : (uint32_t)child_delta);
+        undo_move(pos, c.m[best]);
+    }
+    store(ms, key, phi, delta);
+}
+
+/* Follows proven children from the root; entries lost to replacement are searched again. */
+static int extract_pv(MateSearch *ms, Position *pos, int plies, Move *pv) {
+    int n = 0;
+    bool attacker = true;
+    while (plies > 0 && !ms->aborted) {
+        Children c;
+        gen_children(pos, attacker, plies, &c);
+        if (c.n == 0) break;
+        int pick = -1;
+        for (int pass = 0; pass < 2 && pick < 0; ++pass) {
+            for (int i = 0; i < c.n && pick < 0; ++i) {
+                uint32_t cphi;
+                uint32_t cdelta;
+                lookup(ms, c.k[i], &cphi, &cdelta);
+                if (attacker ? cdelta == 0 : cphi == 0) pick = i;
+            }
+            if (pick < 0) mid(ms, pos, plies, attacker, DFPN_INF, DFPN_INF);
+        }
+        if (pick < 0) break;
+        make_move(pos, c.m[pick]);
+        pv[n++] = c.m[pick];
+        plies--;
+        attacker = !attacker;
+    }
+    for (int i = n - 1; i >= 0; --i) undo_move(pos, pv[i]);
+    return n;
+}
+
+int mate_search(MateSearch *ms, Position *pos, int max_moves, Move *pv, int *pv_len) {
+    memset(ms->t, 0, (ms->mask + 1) * sizeof(MateEntry));
+    ms->nodes = 0;
+    ms->aborted = false;
+    *pv_len = 0;
+    if (max_moves > MATE_MAX_MOVES) max_moves = MATE_MAX_MOVES;
+    for (int moves = 1; moves <= max_moves; ++moves) {
+        int plies = 2 * moves - 1;
+        mid(ms, pos, plies, true, DFPN_INF, DFPN_INF);
+        if (ms->aborted) return 0;
+        uint32_t phi;
+        uint32_t delta;
+        lookup(ms, slot_key(pos->key, plies), &phi, &delta);
+        if (phi != 0) continue;
+        *pv_len = extract_pv(ms, pos, plies, pv);
+        return moves;
+    }
+    return 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <stddef.h>
+#include "position.h"
+
+#define MATE_MAX_MOVES 32
+#define MATE_HASH_MB 16
+
+typedef struct {
+    uint64_t key;
+    uint32_t phi;
+    uint32_t delta;
+} MateEntry;
+
+typedef struct {
+    MateEntry *t;
+    uint64_t mask;
+    uint64_t nodes;
+    uint64_t max_nodes;
+    uint64_t deadline_ms;
+    bool aborted;
+} MateSearch;
+
+bool mate_init(MateSearch *ms, size_t mb);
+void mate_free(MateSearch *ms);
+int mate_search(MateSearch *ms, Position *pos, int max_moves, Move *pv, int *pv_len);
@@ -7,6 +7,28 @@ static void add_move(MoveList *list, Move mv) {
     if (list->n < MAX_MOVES) list->m[list->n++] = mv;
 }
 
+static bool can_castle(const Position *pos, int side, bool kingside) {
+    int ksq = side == WHITE ? 4 : 60;
+    int them = side ^ 1;
+    if (pos->king_sq[side] != ksq) return false;
+    if (kingside) {
+        uint8_t right = (uint8_t)(side == WHITE ? 1u << 0 : 1u << 2);
+        U64 between = (1ULL << (ksq + 1)) | (1ULL << (ksq + 2));
+        return (pos->castle_rights & right) &&
+               !(pos->occ & between) &&
+               !pos_state(pos)->checkers &&
+               !is_square_attacked(pos, ksq + 1, them) &&
+               !is_square_attacked(pos, ksq + 2, them);
+    }
+    uint8_t right = (uint8_t)(side == WHITE ? 1u << 1 : 1u << 3);
+    U64 between = (1ULL << (ksq - 1)) | (1ULL << (ksq - 2)) | (1ULL << (ksq - 3));
+    return (pos->castle_rights & right) &&
+           !(pos->occ & between) &&
+           !pos_state(pos)->checkers &&
+           !is_square_attacked(pos, ksq - 1, them) &&
+           !is_square_attacked(pos, ksq - 2, them);
+}
+
 void gen_pseudo_legal(const Position *pos, MoveList *list) {
     list->n = 0;
     int side = pos->side;
@@ -170,41 +192,147 @@ void gen_pseudo_legal(const Position *pos, MoveList *list) {
         add_move(list, move_encode(king_sq, to, pos->piece_on[king_sq], cap, EMPTY, flags));
     }
 
-    if (side == WHITE && king_sq == 4) {
-        if ((pos->castle_rights & (1 << 0)) &&
-            !(occ & ((1ULL << 5) | (1ULL << 6))) &&
-            !is_square_attacked(pos, 4, BLACK) &&
-            !is_square_attacked(pos, 5, BLACK) &&
-            !is_square_attacked(pos, 6, BLACK)) {
-            add_move(list, move_encode(4, 6, WK, EMPTY, EMPTY, FLAG_CASTLE));
-        }
-        if ((pos->castle_rights & (1 << 1)) &&
-            !(occ & ((1ULL << 1) | (1ULL << 2) | (1ULL << 3))) &&
-            !is_square_attacked(pos, 4, BLACK) &&
-            !is_square_attacked(pos, 3, BLACK) &&
-            !is_square_attacked(pos, 2, BLACK)) {
-            add_move(list, move_encode(4, 2, WK, EMPTY, EMPTY, FLAG_CASTLE));
-        }
-    } else if (side == BLACK && king_sq == 60) {
-        if ((pos->castle_rights & (1 << 2)) &&
-            !(occ & ((1ULL << 61) | (1ULL << 62))) &&
-            !is_square_attacked(pos, 60, WHITE) &&
-            !is_square_attacked(pos, 61, WHITE) &&
-            !is_square_attacked(pos, 62, WHITE)) {
-            add_move(list, move_encode(60, 62, BK, EMPTY, EMPTY, FLAG_CASTLE));
-        }
-        if ((pos->castle_rights & (1 << 3)) &&
-            !(occ & ((1ULL << 57) | (1ULL << 58) | (1ULL << 59))) &&
-            !is_square_attacked(pos, 60, WHITE) &&
-            !is_square_attacked(pos, 59, WHITE) &&
-            !is_square_attacked(pos, 58, WHITE)) {
-            add_move(list, move_encode(60, 58, BK, EMPTY, EMPTY, FLAG_CASTLE));
+    if (can_castle(pos, side, true)) {
+        add_move(list, side == WHITE ? move_encode(4, 6, WK, EMPTY, EMPTY, FLAG_CASTLE)
+                                     : move_encode(60, 62, BK, EMPTY, EMPTY, FLAG_CASTLE));
+    }
+    if (can_castle(pos, side, false)) {
+        add_move(list, side == WHITE ? move_encode(4, 2, WK, EMPTY, EMPTY, FLAG_CASTLE)
+                                     : move_encode(60, 58, BK, EMPTY, EMPTY, FLAG_CASTLE));
+    }
+}
+
+bool move_is_legal(const Position *pos, Move mv) {
+    int side = pos->side;
+    int from = M_FROM(mv);
+    int to = M_TO(mv);
+    uint32_t flags = M_FLAGS(mv);
+    if (flags & FLAG_CASTLE) return true;
+
+    const State *st = pos_state(pos);
+    Piece pc = M_PIECE(mv);
+    if (!st->checkers && pc != WK && pc != BK && !(flags & FLAG_EP)) {
+        return !(st->blockers[side] & (1ULL << from)) || (LINE[from][pos->king_sq[side]] & (1ULL << to));
+    }
+
+    U64 from_bb = 1ULL << from;
+    U64 to_bb = 1ULL << to;
+    U64 removed = to_bb;
+    U64 occ = (pos->occ ^ from_bb) | to_bb;
+    if (flags & FLAG_EP) {
+        int cap_sq = to + (side == WHITE ? -8 : 8);
+        removed = 1ULL << cap_sq;
+        occ ^= removed;
+    }
+    int ksq = pc == (side == WHITE ? WK : BK) ? to : pos->king_sq[side];
+    U64 enemies = pos->bb_color[side ^ 1] & ~removed;
+    return !(attackers_to(pos, ksq, occ) & enemies);
+}
+
+bool gives_check(const Position *pos, Move mv) {
+    const State *st = pos_state(pos);
+    int us = pos->side;
+    int from = M_FROM(mv);
+    int to = M_TO(mv);
+    uint32_t flags = M_FLAGS(mv);
+    int ksq = pos->king_sq[us ^ 1];
+    U64 to_bb = 1ULL << to;
+    if (!(flags & FLAG_PROMO) && (st->check_sq[(M_PIECE(mv) - 1) % 6] & to_bb)) return true;
+    if ((st->blockers[us ^ 1] & (1ULL << from)) && !(LINE[from][ksq] & to_bb)) return true;
+    if (!(flags & (FLAG_PROMO | FLAG_EP | FLAG_CASTLE))) return false;
+
+    U64 occ = (pos->occ ^ (1ULL << from)) | to_bb;
+    U64 king_bb = 1ULL << ksq;
+    if (flags & FLAG_PROMO) {
+        switch ((M_PROMO(mv) - 1) % 6) {
+            case 1: return KNIGHT_ATTACKS[to] & king_bb;
+            case 2: return bishop_attacks(to, occ) & king_bb;
+            case 3: return rook_attacks(to, occ) & king_bb;
+            default: return (bishop_attacks(to, occ) | rook_attacks(to, occ)) & king_bb;
         }
     }
+    if (flags & FLAG_EP) {
+        occ ^= 1ULL << (to + (us == WHITE ? -8 : 8));
+        U64 queens = pos->bb_piece[(us == WHITE ? WQ : BQ) - 1];
+        U64 bishops = pos->bb_piece[(us == WHITE ? WB : BB) - 1] | queens;
+        U64 rooks = pos->bb_piece[(us == WHITE ? WR : BR) - 1] | queens;
+        return (bishop_attacks(ksq, occ) & bishops) || (rook_attacks(ksq, occ) & rooks);
+    }
+    int rook_from = to > from ? from + 3 : from - 4;
+    int rook_to = to > from ? from + 1 : from - 1;
+    occ = (occ ^ (1ULL << rook_from)) | (1ULL << rook_to);
+    return rook_attacks(rook_to, occ) & king_bb;
 }
 
-bool is_legal_move(Position *pos, Move mv) {
-    if (!make_move(pos, mv)) return false;
-    undo_move(pos, mv);
-    return true;
+Move move_from_squares(const Position *pos, int from, int to, int promo_type) {
+    if (from < 0 || from > 63 || to < 0 || to > 63 || from == to) return 0;
+    int side = pos->side;
+    Piece pc = pos->piece_on[from];
+    if (pc == EMPTY || piece_color(pc) != side) return 0;
+    Piece cap = pos->piece_on[to];
+    if (cap != EMPTY && piece_color(cap) == side) return 0;
+    U64 to_bb = 1ULL << to;
+    uint32_t flags = cap != EMPTY ? FLAG_CAPTURE : FLAG_NONE;
+    Piece promo = EMPTY;
+
+    switch (pc) {
+        case WP:
+        case BP: {
+            int push = side == WHITE ? 8 : -8;
+            int start_rank = side == WHITE ? 1 : 6;
+            int last_rank = side == WHITE ? 7 : 0;
+            if (PAWN_ATTACKS[side][from] & to_bb) {
+                if (cap == EMPTY) {
+                    if (to != pos->ep_sq) return 0;
+                    cap = side == WHITE ? BP : WP;
+                    flags = FLAG_EP | FLAG_CAPTURE;
+                }
+            } else if (cap != EMPTY) {
+                return 0;
+            } else if (to == from + 2 * push && (from >> 3) == start_rank &&
+                       pos->piece_on[from + push] == EMPTY) {
+                flags |= FLAG_DBLPUSH;
+            } else if (to != from + push) {
+                return 0;
+            }
+            if ((to >> 3) == last_rank) {
+                if (promo_type < 1 || promo_type > 4) return 0;
+                promo = (Piece)((side == WHITE ? WP : BP) + promo_type);
+                flags |= FLAG_PROMO;
+            } else if (promo_type) {
+                return 0;
+            }
+            return move_encode(from, to, pc, cap, promo, flags);
+        }
+        case WN:
+        case BN:
+            if (!(KNIGHT_ATTACKS[from] & to_bb)) return 0;
+            break;
+        case WB:
+        case BB:
+            if (!(bishop_attacks(from, pos->occ) & to_bb)) return 0;
+            break;
+        case WR:
+        case BR:
+            if (!(rook_attacks(from, pos->occ) & to_bb)) return 0;
+            break;
+        case WQ:
+        case BQ:
+            if (!((rook_attacks(from, pos->occ) | bishop_attacks(from, pos->occ)) & to_bb)) return 0;
+            break;
+        case WK:
+        case BK:
+            if (KING_ATTACKS[from] & to_bb) break;
+            if (to == from + 2 && can_castle(pos, side, true)) {
+                return move_encode(from, to, pc, EMPTY, EMPTY, FLAG_CASTLE);
+            }
+            if (to == from - 2 && can_castle(pos, side, false)) {
+                return move_encode(from, to, pc, EMPTY, EMPTY, FLAG_CASTLE);
+            }
+            return 0;
+        default:
+            return 0;
+    }
+    if (promo_type) return 0;
+    return move_encode(from, to, pc, cap, EMPTY, flags);
 }
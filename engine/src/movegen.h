@@ -9,4 +9,6 @@ typedef struct {
 } MoveList;
 
 void gen_pseudo_legal(const Position *pos, MoveList *list);
-bool is_legal_move(Position *pos, Move mv);
+bool move_is_legal(const Position *pos, Move mv);
+bool gives_check(const Position *pos, Move mv);
+Move move_from_squares(const Position *pos, int from, int to, int promo_type);
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nodessuite.h"
+
+#define NODES_SUITE_MAX_BUDGETS 16
+
+typedef struct {
+    char fen[256];
+    int n_budgets;
+    uint64_t budgets[NODES_SUITE_MAX_BUDGETS];
+} NodesEntry;
+
+static bool parse_epd_line(const char *line, NodesEntry *e) {
+    memset(e, 0, sizeof(*e));
+    const char *semi = strchr(line, ';');
+    if (!semi) return false;
+    size_t len = (size_t)(semi - line);
+    while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t')) --len;
+    if (len == 0 || len >= sizeof(e->fen)) return false;
+    memcpy(e->fen, line, len);
+    e->fen[len] = '\0';
+
+    const char *p = semi;
+    while ((p = strchr(p, ';')) != NULL) {
+        ++p;
+        while (*p == ' ') ++p;
+        if (strncmp(p, "nodes ", 6)) continue;
+        const char *q = p + 6;
+        while (e->n_budgets < NODES_SUITE_MAX_BUDGETS) {
+            char *end;
+            unsigned long long n = strtoull(q, &end, 10);
+            if (end == q) break;
+            e->budgets[e->n_budgets++] = n;
+            q = end;
+        }
+    }
+    return e->n_budgets > 0;
+}
+
+static void keep_last(const ChessInfo *info, void *user) {
+    *(ChessInfo *)user = *info;
+}
+
+/* Searches from a cleared engine and reports the last completed iteration through *last. */
+static bool search_fresh(ChessEngine *eng, const char *fen, const ChessLimits *lim, ChessInfo *last, ChessInfo *out) {
+    chess_new_game(eng);
+    if (!chess_set_position(eng, fen, NULL, 0)) return false;
+    memset(last, 0, sizeof(*last));
+    return chess_search(eng, lim, keep_last, last, out);
+}
+
+/* For each node budget, the move and score of a node-limited search must be those of its last
+ * completed iteration, and a fresh search to that depth must reproduce them. */
+int nodes_suite_run(ChessEngine *eng, const char *epd_path) {
+    FILE *f = fopen(epd_path, "r");
+    if (!f) {
+        printf("nodessuite: cannot open %s\n", epd_path);
+        return -1;
+    }
+    int failures = 0;
+    printf("%3s %8s %5s %6s %6s  %-6s %s\n", "#", "nodes", "depth", "score", "move", "result", "fen");
+    char line[1024];
+    int index = 0;
+    while (fgets(line, sizeof(line), f)) {
+        NodesEntry e;
+        if (line[0] == '#' || !parse_epd_line(line, &e)) continue;
+        ++index;
+        for (int i = 0; i < e.n_budgets; ++i) {
+            ChessLimits lim;
+            memset(&lim, 0, sizeof(lim));
+            lim.nodes = e.budgets[i];
+            ChessInfo last, out;
+            bool ok = search_fresh(eng, e.fen, &lim, &last, &out) && last.depth > 0;
+            ok = ok && out.score_cp == last.score_cp && !strcmp(out.bestmove, last.bestmove);
+            if (ok) {
+                ChessInfo ref_last, ref;
+                memset(&lim, 0, sizeof(lim));
+                lim.depth = last.depth;
+                ok = search_fresh(eng, e.fen, &lim, &ref_last, &ref) && ref.score_cp == out.score_cp
+                  && !strcmp(ref.bestmove, out.bestmove);
+            }
+            if (!ok) failures++;
+            printf("%3d %8llu %5d %6d %6s  %-6s %s\n", index, (unsigned long long)e.budgets[i], last.depth,
+                   out.score_cp, out.bestmove, ok ? "ok" : "FAIL", e.fen);
+        }
+    }
+    fclose(f);
+    printf("failures %d\n", failures);
+    fflush(stdout);
+    return failures;
+}
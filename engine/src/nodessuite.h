@@ -0,0 +1,4 @@
+#pragma once
+#include "chessv2.h"
+
+int nodes_suite_run(ChessEngine *eng, const char *epd_path);
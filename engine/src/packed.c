@@ -0,0 +1,53 @@
+#include <string.h>
+#include "packed.h"
+
+_Static_assert(sizeof(PackedPos) == 32, "packed position layout changed");
+
+void pack_position(const Position *pos, int score, int result, PackedPos *out) {
+    memset(out, 0, sizeof(*out));
+    out->occ = pos->occ;
+    U64 occ = pos->occ;
+    for (int i = 0; occ && i < 32; ++i) {
+        int sq = lsb_index(occ);
+        occ &= occ - 1;
+        out->pieces[i >> 1] |= (uint8_t)((unsigned)pos->piece_on[sq] << ((i & 1) * 4));
+    }
+    out->score = (int16_t)(score > INT16_MAX ? INT16_MAX : score < INT16_MIN ? INT16_MIN : score);
+    out->result = (int8_t)result;
+    out->flags = (uint8_t)((pos->side == BLACK ? PACKED_BLACK_TO_MOVE : 0)
+                           | (pos->castle_rights << PACKED_CASTLE_SHIFT));
+    out->ep_sq = (uint8_t)(pos->ep_sq >= 0 ? pos->ep_sq : PACKED_NO_EP);
+    out->halfmove_clock = pos->halfmove_clock;
+    out->fullmove = (uint16_t)pos_fullmove(pos);
+}
+
+bool unpack_position(const PackedPos *in, Position *pos, int *score, int *result) {
+    if (popcount64(in->occ) > 32) return false;
+    memset(pos, 0, sizeof(*pos));
+    pos->king_sq[WHITE] = -1;
+    pos->king_sq[BLACK] = -1;
+    U64 occ = in->occ;
+    for (int i = 0; occ; ++i) {
+        int sq = lsb_index(occ);
+        occ &= occ - 1;
+        int p = (in->pieces[i >> 1] >> ((i & 1) * 4)) & 15;
+        if (p < WP || p > BK) return false;
+        pos->piece_on[sq] = (Piece)p;
+        pos->bb_piece[p - 1] |= 1ULL << sq;
+        if (p == WK) pos->king_sq[WHITE] = sq;
+        if (p == BK) pos->king_sq[BLACK] = sq;
+    }
+    if (pos->king_sq[WHITE] < 0 || pos->king_sq[BLACK] < 0) return false;
+    pos->side = (in->flags & PACKED_BLACK_TO_MOVE) ? BLACK : WHITE;
+    pos->castle_rights = (uint8_t)((in->flags >> PACKED_CASTLE_SHIFT) & 15u);
+    pos->ep_sq = in->ep_sq < 64 ? in->ep_sq : -1;
+    pos->halfmove_clock = in->halfmove_clock;
+    pos->fullmove_base = in->fullmove > 0 ? in->fullmove : 1;
+    pos->ply = 0;
+    pos_update_occupancy(pos);
+    pos_compute_key(pos);
+    pos_update_checks(pos);
+    if (score) *score = in->score;
+    if (result) *result = in->result;
+    return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "position.h"
+
+#define PACKED_NO_EP 64
+
+typedef struct {
+    uint64_t occ;
+    uint8_t pieces[16];
+    int16_t score;
+    int8_t result;
+    uint8_t flags;
+    uint8_t ep_sq;
+    uint8_t halfmove_clock;
+    uint16_t fullmove;
+} PackedPos;
+
+enum { PACKED_BLACK_TO_MOVE = 1 << 0, PACKED_CASTLE_SHIFT = 1 };
+
+void pack_position(const Position *pos, int score, int result, PackedPos *out);
+bool unpack_position(const PackedPos *in, Position *pos, int *score, int *result);
@@ -1,17 +1,198 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include "perft.h"
 #include "movegen.h"
 #include "make.h"
 
-uint64_t perft(Position *pos, int depth) {
+#define PERFT_DEPTH_SHIFT 56
+#define PERFT_NODES_MASK ((1ULL << PERFT_DEPTH_SHIFT) - 1)
+
+void perft_tt_init(PerftTT *tt, size_t mb) {
+    tt->t = NULL;
+    tt->n = 0;
+    tt->mask = 0;
+    if (mb == 0) return;
+    size_t n = mb * 1024u * 1024u / sizeof(PerftEntry);
+    size_t pow2 = 1;
+    while (pow2 * 2 <= n) pow2 <<= 1;
+    tt->t = (PerftEntry *)calloc(pow2, sizeof(PerftEntry));
+    if (!tt->t) return;
+    tt->n = pow2;
+    tt->mask = (uint64_t)(pow2 - 1);
+}
+
+void perft_tt_free(PerftTT *tt) {
+    free(tt->t);
+    tt->t = NULL;
+    tt->n = 0;
+    tt->mask = 0;
+}
+
+static uint64_t slot_key(uint64_t key, int depth) {
+    return key ^ ((uint64_t)depth * UINT64_C(0x9e3779b97f4a7c15));
+}
+
+static bool perft_tt_probe(PerftTT *tt, uint64_t key, int depth, uint64_t *nodes) {
+    uint64_t k = slot_key(key, depth);
+    PerftEntry *e = &tt->t[k & tt->mask];
+    uint64_t check = atomic_load_explicit(&e->check, memory_order_relaxed);
+    uint64_t data = atomic_load_explicit(&e->data, memory_order_relaxed);
+    if ((check ^ data) != k || (int)(data >> PERFT_DEPTH_SHIFT) != depth) return false;
+    *nodes = data & PERFT_NODES_MASK;
+    return true;
+}
+
+static void perft_tt_store(PerftTT *tt, uint64_t key, int depth, uint64_t nodes) {
+    uint64_t k = slot_key(key, depth);
+    PerftEntry *e = &tt->t[k & tt->mask];
+    uint64_t data = ((uint64_t)depth << PERFT_DEPTH_SHIFT) | (nodes & PERFT_NODES_MASK);
+    atomic_store_explicit(&e->check, k ^ data, memory_order_relaxed);
+    atomic_store_explicit(&e->data, data, memory_order_relaxed);
+}
+
+uint64_t perft(Position *pos, int depth, PerftTT *tt) {
     if (depth == 0) return 1;
+    uint64_t nodes = 0;
+    bool hashed = tt && tt->t && depth > 1;
+    if (hashed && perft_tt_probe(tt, pos->key, depth, &nodes)) return nodes;
     MoveList list;
     gen_pseudo_legal(pos, &list);
-    uint64_t nodes = 0;
+    if (depth == 1) {
+        for (int i = 0; i < list.n; ++i) {
+            if (move_is_legal(pos, list.m[i])) nodes++;
+        }
+        return nodes;
+    }
     for (int i = 0; i < list.n; ++i) {
         Move mv = list.m[i];
         if (!make_move(pos, mv)) continue;
-        nodes += perft(pos, depth - 1);
+        nodes += perft(pos, depth - 1, tt);
         undo_move(pos, mv);
     }
+    if (hashed) perft_tt_store(tt, pos->key, depth, nodes);
     return nodes;
 }
+
+uint64_t perft_divide(Position *pos, int depth, PerftTT *tt, PerftDivideFn fn, void *user) {
+    if (depth <= 0) return 1;
+    MoveList list;
+    gen_pseudo_legal(pos, &list);
+    uint64_t total = 0;
+    for (int i = 0; i < list.n; ++i) {
+        Move mv = list.m[i];
+        if (!make_move(pos, mv)) continue;
+        uint64_t nodes = perft(pos, depth - 1, tt);
+        undo_move(pos, mv);
+        if (fn) fn(mv, nodes, user);
+        total += nodes;
+    }
+    return total;
+}
+
+typedef struct {
+    const Position *root;
+    const Move *first;
+    const Move *second;
+    uint64_t *counts;
+    int n_items;
+    int depth;
+    PerftTT *tt;
+    atomic_int next;
+} PerftJob;
+
+static void *perft_worker(void *arg) {
+    PerftJob *job = (PerftJob *)arg;
+    Position *pos = (Position *)malloc(sizeof(Position));
+    if (!pos) return NULL;
+    memcpy(pos, job->root, sizeof(Position));
+    for (;;) {
+        int i = atomic_fetch_add(&job->next, 1);
+        if (i >= job->n_items) break;
+        make_move(pos, job->first[i]);
+        make_move(pos, job->second[i]);
+        job->counts[i] = perft(pos, job->depth - 2, job->tt);
+        undo_move(pos, job->second[i]);
+        undo_move(pos, job->first[i]);
+    }
+    free(pos);
+    return NULL;
+}
+
+uint64_t perft_parallel(const Position *pos, int depth, PerftTT *tt, int threads,
+                        PerftDivideFn fn, void *user) {
+    Position *root = (Position *)malloc(sizeof(Position));
+    if (!root) return 0;
+    memcpy(root, pos, sizeof(Position));
+    if (threads <= 1 || depth < 3) {
+        uint64_t total = perft_divide(root, depth, tt, fn, user);
+        free(root);
+        return total;
+    }
+
+    MoveList roots;
+    gen_pseudo_legal(root, &roots);
+    int n_roots = 0;
+    for (int i = 0; i < roots.n; ++i) {
+        if (move_is_legal(root, roots.m[i])) roots.m[n_roots++] = roots.m[i];
+    }
+    roots.n = n_roots;
+
+    size_t cap = (size_t)n_roots * MAX_MOVES + 1;
+    Move *first = (Move *)malloc(cap * sizeof(Move));
+    Move *second = (Move *)malloc(cap * sizeof(Move));
+    int *owner = (int *)malloc(cap * sizeof(int));
+    uint64_t *counts = (uint64_t *)calloc(cap, sizeof(uint64_t));
+    pthread_t *tids = (pthread_t *)malloc((size_t)threads * sizeof(pthread_t));
+    uint64_t total = 0;
+    if (first && second && owner && counts && tids) {
+        int n_items = 0;
+        for (int r = 0; r < roots.n; ++r) {
+            MoveList replies;
+            make_move(root, roots.m[r]);
+            gen_pseudo_legal(root, &replies);
+            for (int i = 0; i < replies.n; ++i) {
+                if (!move_is_legal(root, replies.m[i])) continue;
+                first[n_items] = roots.m[r];
+                second[n_items] = replies.m[i];
+                owner[n_items] = r;
+                n_items++;
+            }
+            undo_move(root, roots.m[r]);
+        }
+
+        PerftJob job;
+        job.root = root;
+        job.first = first;
+        job.second = second;
+        job.counts = counts;
+        job.n_items = n_items;
+        job.depth = depth;
+        job.tt = tt;
+        atomic_init(&job.next, 0);
+
+        int started = 0;
+        for (int t = 0; t < threads && t < n_items; ++t) {
+            if (pthread_create(&tids[t], NULL, perft_worker, &job) != 0) break;
+            started++;
+        }
+        if (started == 0) perft_worker(&job);
+        for (int t = 0; t < started; ++t) pthread_join(tids[t], NULL);
+
+        int item = 0;
+        for (int r = 0; r < roots.n; ++r) {
+            uint64_t sub = 0;
+            while (item < n_items && owner[item] == r) sub += counts[item++];
+            if (fn) fn(roots.m[r], sub, user);
+            total += sub;
+        }
+    }
+
+    free(first);
+    free(second);
+    free(owner);
+    free(counts);
+    free(tids);
+    free(root);
+    return total;
+}
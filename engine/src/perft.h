@@ -1,4 +1,24 @@
 #pragma once
+#include <stdatomic.h>
 #include "position.h"
 
-uint64_t perft(Position *pos, int depth);
+typedef struct {
+    _Atomic uint64_t check;
+    _Atomic uint64_t data;
+} PerftEntry;
+
+typedef struct {
+    PerftEntry *t;
+    size_t n;
+    uint64_t mask;
+} PerftTT;
+
+typedef void (*PerftDivideFn)(Move mv, uint64_t nodes, void *user);
+
+void perft_tt_init(PerftTT *tt, size_t mb);
+void perft_tt_free(PerftTT *tt);
+
+uint64_t perft(Position *pos, int depth, PerftTT *tt);
+uint64_t perft_divide(Position *pos, int depth, PerftTT *tt, PerftDivideFn fn, void *user);
+uint64_t perft_parallel(const Position *pos, int depth, PerftTT *tt, int threads,
+                        PerftDivideFn fn, void *user);
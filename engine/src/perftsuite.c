@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "perftsuite.h"
+#include "eval.h"
+#include "make.h"
+#include "movegen.h"
+#include "time.h"
+
+#define SUITE_MAX_DEPTH 16
+#define PSQ_CHECK_DEPTH 2
+
+typedef struct {
+    char fen[256];
+    uint64_t expected[SUITE_MAX_DEPTH + 1];
+} SuiteEntry;
+
+static bool parse_epd_line(const char *line, SuiteEntry *e) {
+    memset(e, 0, sizeof(*e));
+    const char *semi = strchr(line, ';');
+    if (!semi) return false;
+    size_t len = (size_t)(semi - line);
+    while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t')) --len;
+    if (len == 0 || len >= sizeof(e->fen)) return false;
+    memcpy(e->fen, line, len);
+    e->fen[len] = '\0';
+
+    const char *p = semi;
+    while ((p = strchr(p, ';')) != NULL) {
+        ++p;
+        while (*p == ' ') ++p;
+        if (*p != 'D') continue;
+        char *end = NULL;
+        long depth = strtol(p + 1, &end, 10);
+        if (end == p + 1 || depth < 1 || depth > SUITE_MAX_DEPTH) continue;
+        e->expected[depth] = strtoull(end, NULL, 10);
+    }
+    return true;
+}
+
+/* The incremental Position.psq must match a fresh sum over the board. */
+static int psq_mismatches(Position *pos, int depth) {
+    int psq = 0;
+    for (U64 occ = pos->occ; occ; occ &= occ - 1) {
+        int sq = lsb_index(occ);
+        psq += PSQT[(int)pos->piece_on[sq] * 64 + sq];
+    }
+    int bad = psq != pos->psq;
+    if (depth == 0) return bad;
+    MoveList list;
+    gen_pseudo_legal(pos, &list);
+    for (int i = 0; i < list.n; ++i) {
+        if (!make_move(pos, list.m[i])) continue;
+        bad += psq_mismatches(pos, depth - 1);
+        undo_move(pos, list.m[i]);
+    }
+    return bad;
+}
+
+int perft_suite_run(ChessEngine *eng, const char *path, int max_depth) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        printf("perftsuite: cannot open %s\n", path);
+        return -1;
+    }
+    if (max_depth <= 0 || max_depth > SUITE_MAX_DEPTH) max_depth = SUITE_MAX_DEPTH;
+
+    printf("%3s %5s %14s %9s %12s  %-6s %s\n", "#", "depth", "nodes", "ms", "nps", "result", "fen");
+    char line[1024];
+    int index = 0;
+    int failures = 0;
+    uint64_t all_nodes = 0;
+    uint64_t all_ms = 0;
+    Position *pos = (Position *)malloc(sizeof(Position));
+    if (!pos) {
+        fclose(f);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        SuiteEntry e;
+        if (line[0] == '#' || !parse_epd_line(line, &e)) continue;
+        ++index;
+        if (!chess_set_position(eng, e.fen, NULL, 0)) {
+            printf("%3d %5s %14s %9s %12s  %-6s %s\n", index, "-", "-", "-", "-", "BADFEN", e.fen);
+            failures++;
+            continue;
+        }
+        uint64_t nodes = 0;
+        uint64_t ms = 0;
+        int deepest = 0;
+        bool ok = true;
+        for (int d = 1; d <= max_depth; ++d) {
+            if (!e.expected[d]) continue;
+            uint64_t start = now_ms();
+            uint64_t got = chess_perft(eng, d);
+            ms += now_ms() - start;
+            nodes += got;
+            deepest = d;
+            if (got != e.expected[d]) {
+                printf("    depth %d: expected %llu got %llu\n", d,
+                       (unsigned long long)e.expected[d], (unsigned long long)got);
+                ok = false;
+            }
+        }
+        if (!deepest) continue;
+        if (pos_from_fen(pos, e.fen)) {
+            int bad = psq_mismatches(pos, PSQ_CHECK_DEPTH);
+            if (bad) {
+                printf("    psq: %d positions where Position.psq disagrees with a fresh sum\n", bad);
+                ok = false;
+            }
+        }
+        if (!ok) failures++;
+        all_nodes += nodes;
+        all_ms += ms;
+        printf("%3d %5d %14llu %9llu %12llu  %-6s %s\n", index, deepest,
+               (unsigned long long)nodes, (unsigned long long)ms,
+               (unsigned long long)(ms ? nodes * 1000u / ms : nodes),
+               ok ? "ok" : "FAIL", e.fen);
+        fflush(stdout);
+    }
+    fclose(f);
+    free(pos);
+    printf("total nodes %llu time %llu nps %llu failures %d\n",
+           (unsigned long long)all_nodes, (unsigned long long)all_ms,
+           (unsigned long long)(all_ms ? all_nodes * 1000u / all_ms : all_nodes), failures);
+    fflush(stdout);
+    return failures;
+}
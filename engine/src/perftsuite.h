@@ -0,0 +1,4 @@
+#pragma once
+#include "chessv2.h"
+
+int perft_suite_run(ChessEngine *eng, const char *path, int max_depth);
@@ -4,6 +4,9 @@
 #include <stdlib.h>
 #include "position.h"
 #include "zobrist.h"
+#include "tables.h"
+#include "attack.h"
+#include "eval.h"
 
 static void pos_clear(Position *pos) {
     memset(pos, 0, sizeof(*pos));
@@ -11,6 +14,7 @@ static void pos_clear(Position *pos) {
     pos->ep_sq = -1;
     pos->castle_rights = 0;
     pos->halfmove_clock = 0;
+    pos->fullmove_base = 1;
     pos->side = WHITE;
     pos->king_sq[WHITE] = -1;
     pos->king_sq[BLACK] = -1;
@@ -24,11 +28,60 @@ void pos_update_occupancy(Position *pos) {
     pos->occ = pos->bb_color[WHITE] | pos->bb_color[BLACK];
 }
 
+static U64 slider_blockers(const Position *pos, int side) {
+    int ksq = pos->king_sq[side];
+    int them = side ^ 1;
+    U64 queens = pos->bb_piece[(them == WHITE ? WQ : BQ) - 1];
+    U64 snipers = (ROOK_RAYS[ksq] & (pos->bb_piece[(them == WHITE ? WR : BR) - 1] | queens))
+                | (BISHOP_RAYS[ksq] & (pos->bb_piece[(them == WHITE ? WB : BB) - 1] | queens));
+    U64 blockers = 0;
+    while (snipers) {
+        int sq = lsb_index(snipers);
+        snipers &= snipers - 1;
+        U64 between = BETWEEN[ksq][sq] & pos->occ;
+        if (between && !(between & (between - 1))) blockers |= between;
+    }
+    return blockers;
+}
+
+void pos_update_pins(Position *pos) {
+    State *st = &pos->st[pos->ply];
+    int them = pos->side ^ 1;
+    int ksq = pos->king_sq[them];
+    st->blockers[WHITE] = slider_blockers(pos, WHITE);
+    st->blockers[BLACK] = slider_blockers(pos, BLACK);
+    st->check_sq[0] = PAWN_ATTACKS[them][ksq];
+    st->check_sq[1] = KNIGHT_ATTACKS[ksq];
+    st->check_sq[2] = bishop_attacks(ksq, pos->occ);
+    st->check_sq[3] = rook_attacks(ksq, pos->occ);
+    st->check_sq[4] = st->check_sq[2] | st->check_sq[3];
+    st->check_sq[5] = 0;
+}
+
+void pos_update_checks(Position *pos) {
+    State *st = &pos->st[pos->ply];
+    int us = pos->side;
+    if (pos->king_sq[us] < 0 || pos->king_sq[us ^ 1] < 0) {
+        memset(st->check_sq, 0, sizeof(st->check_sq));
+        st->checkers = 0;
+        st->blockers[WHITE] = 0;
+        st->blockers[BLACK] = 0;
+        return;
+    }
+    st->checkers = attackers_to(pos, pos->king_sq[us], pos->occ) & pos->bb_color[us ^ 1];
+    pos_update_pins(pos);
+}
+
 void pos_compute_key(Position *pos) {
     uint64_t key = 0;
+    pos->mat_key = 0;
+    pos->psq = 0;
     for (int sq = 0; sq < 64; ++sq) {
         Piece p = pos->piece_on[sq];
-        if (p != EMPTY) key ^= Z_PIECE[p - 1][sq];
+        if (p == EMPTY) continue;
+        key ^= Z_PIECE[p - 1][sq];
+        pos->mat_key += MAT_KEY(p);
+        pos->psq += PSQT[(int)p * 64 + sq];
     }
     key ^= Z_CASTLE[pos->castle_rights & 15u];
     if (pos->ep_sq >= 0) {
@@ -87,6 +140,63 @@ void pos_print_pretty(const Position *pos, int last_from, int last_to) {
            (pos->castle_rights & (1u << 3)) ? 'q' : '-',
            pos->ep_sq >= 0 ? "set" : "none");
 }
+void pos_to_fen(const Position *pos, char *out, size_t size) {
+    char buf[128];
+    int n = 0;
+    for (int rank = 7; rank >= 0; --rank) {
+        int empty = 0;
+        for (int file = 0; file < 8; ++file) {
+            Piece p = pos->piece_on[rank * 8 + file];
+            if (p == EMPTY) {
+                empty++;
+                continue;
+            }
+            if (empty) buf[n++] = (char)('0' + empty);
+            empty = 0;
+            buf[n++] = piece_to_char(p);
+        }
+        if (empty) buf[n++] = (char)('0' + empty);
+        if (rank) buf[n++] = '/';
+    }
+    buf[n++] = ' ';
+    buf[n++] = pos->side == WHITE ? 'w' : 'b';
+    buf[n++] = ' ';
+    if (!pos->castle_rights) buf[n++] = '-';
+    if (pos->castle_rights & (1u << 0)) buf[n++] = 'K';
+    if (pos->castle_rights & (1u << 1)) buf[n++] = 'Q';
+    if (pos->castle_rights & (1u << 2)) buf[n++] = 'k';
+    if (pos->castle_rights & (1u << 3)) buf[n++] = 'q';
+    buf[n++] = ' ';
+    if (pos->ep_sq >= 0) {
+        buf[n++] = (char)('a' + (pos->ep_sq & 7));
+        buf[n++] = (char)('1' + (pos->ep_sq >> 3));
+    } else {
+        buf[n++] = '-';
+    }
+    buf[n] = '\0';
+    snprintf(out, size, "%s %u %d", buf, pos->halfmove_clock, pos_fullmove(pos));
+}
+
+int pos_repetitions(const Position *pos) {
+    int count = 0;
+    int stop = pos->ply - pos->halfmove_clock;
+    for (int i = pos->ply - 2; i >= 0 && i >= stop; i -= 2) {
+        if (pos->st[i].key == pos->key) count++;
+    }
+    return count;
+}
+
+bool pos_insufficient_material(const Position *pos) {
+    U64 heavy = pos->bb_piece[WP - 1] | pos->bb_piece[BP - 1] | pos->bb_piece[WR - 1]
+        | pos->bb_piece[BR - 1] | pos->bb_piece[WQ - 1] | pos->bb_piece[BQ - 1];
+    if (heavy) return false;
+    U64 knights = pos->bb_piece[WN - 1] | pos->bb_piece[BN - 1];
+    U64 bishops = pos->bb_piece[WB - 1] | pos->bb_piece[BB - 1];
+    if (popcount64(knights | bishops) <= 1) return true;
+    const U64 dark = 0xAA55AA55AA55AA55ULL;
+    return !knights && ((bishops & dark) == 0 || (bishops & ~dark) == 0);
+}
+
 static int parse_piece(char c) {
     switch (c) {
         case 'P': return WP;
@@ -172,19 +282,21 @@ bool pos_from_fen(Position *pos, const char *fen) {
         pos->ep_sq = rank * 8 + file;
         p += 2;
     }
-    if (*p != ' ') return false;
-    ++p;
-
-    pos->halfmove_clock = (uint8_t)atoi(p);
-    while (*p && *p != ' ') ++p;
     if (*p == ' ') {
         ++p;
-        pos->ply = atoi(p);
-    } else {
-        pos->ply = 0;
+        pos->halfmove_clock = (uint8_t)atoi(p);
+        while (*p && *p != ' ') ++p;
+        if (*p == ' ') {
+            int fullmove = atoi(p + 1);
+            if (fullmove > 0) pos->fullmove_base = fullmove;
+        }
+    } else if (*p != '\0') {
+        return false;
     }
+    pos->ply = 0;
 
     pos_update_occupancy(pos);
     pos_compute_key(pos);
+    pos_update_checks(pos);
     return true;
 }
@@ -1,8 +1,13 @@
 #pragma once
+#include <stddef.h>
 #include "types.h"
 #include "move.h"
 
 #define MAX_PLY 256
+#define MAX_GAME_PLY 2048
+
+/* Material key: a 4-bit count per piece type, so equal material gives equal keys. */
+#define MAT_KEY(p) (1ULL << (4 * ((p) - 1)))
 
 typedef struct {
     uint64_t key;
@@ -10,6 +15,12 @@ typedef struct {
     uint8_t castle_rights;
     uint8_t halfmove_clock;
     Piece captured;
+    /* Filled by pos_update_checks() for the position at this ply: pieces giving check to the side
+     * to move, pieces shielding each king from an enemy slider, and the squares from which each
+     * piece type of the side to move would check the enemy king. */
+    U64 checkers;
+    U64 blockers[2];
+    U64 check_sq[6];
 } State;
 
 typedef struct {
@@ -23,15 +34,33 @@ typedef struct {
     int king_sq[2];
 
     uint64_t key;
+    uint64_t mat_key;
+    int psq;
     int ep_sq;
     uint8_t castle_rights;
     uint8_t halfmove_clock;
+    int fullmove_base;
     int ply;
 
-    State st[MAX_PLY];
+    State st[MAX_GAME_PLY + MAX_PLY];
 } Position;
 
 bool pos_from_fen(Position *pos, const char *fen);
 void pos_update_occupancy(Position *pos);
 void pos_compute_key(Position *pos);
+void pos_update_checks(Position *pos);
+void pos_update_pins(Position *pos);
 void pos_print_pretty(const Position *pos, int last_from, int last_to);
+void pos_to_fen(const Position *pos, char *out, size_t size);
+int pos_repetitions(const Position *pos);
+bool pos_insufficient_material(const Position *pos);
+
+static inline const State *pos_state(const Position *pos) {
+    return &pos->st[pos->ply];
+}
+
+/* Fullmove number of the current position; fullmove_base is the one read with ply 0. */
+static inline int pos_fullmove(const Position *pos) {
+    int black_started = (pos->side ^ (pos->ply & 1)) == BLACK;
+    return pos->fullmove_base + (pos->ply + black_started) / 2;
+}
@@ -3,100 +3,442 @@
 #include "search.h"
 #include "movegen.h"
 #include "make.h"
+#include "attack.h"
 #include "eval.h"
+#include "endgame.h"
+#include "tb.h"
 #include "time.h"
-#include "tables.h"
+#include "init.h"
+#include "stats.h"
 
-#define INF 32000
-#define MATE 30000
+#define TRACE_MARK(tr, field, v) do { if (tr) (tr)->field = (v); } while (0)
+#define TRACE_FLAG(tr, f) do { if (tr) (tr)->flags |= (f); } while (0)
 
-static SearchLimits CURRENT_LIMITS;
 
-static bool time_up(void) {
-    if (CURRENT_LIMITS.stop) return true;
-    uint64_t now = now_ms();
-    if (CURRENT_LIMITS.hard_stop_ms && now >= CURRENT_LIMITS.hard_stop_ms) {
+#define TIME_CHECK_MASK 1023u
+
+static bool time_up(SearchCtx *ctx) {
+    if (ctx->lim.stop) return true;
+    if (ctx->lim.max_nodes && ctx->lim.nodes >= ctx->lim.max_nodes) {
+        ctx->lim.stop = 1;
+        return true;
+    }
+    if (ctx->lim.hard_stop_ms && (ctx->lim.nodes & TIME_CHECK_MASK) == 0
+        && now_ms() >= ctx->lim.hard_stop_ms) {
+        ctx->lim.stop = 1;
         return true;
     }
     return false;
 }
 
+#define HIST_MAX 16384
+#define MAX_QUIETS 64
+#define RFP_DEPTH 3
+#define RFP_MARGIN 120
+
 static int mvv_lva(Piece attacker, Piece victim) {
     static const int val[13] = {0, 1, 3, 3, 5, 9, 10, 1, 3, 3, 5, 9, 10};
     return val[victim] * 16 - val[attacker];
 }
 
-static int score_move(const SearchCtx *ctx, Move mv, Move tt_move, int ply) {
+/* Pieces of the side to move that are attacked by a pawn or not defended at all. */
+static U64 threatened_pieces(const Position *pos, const EvalAttacks *att) {
+    int us = pos->side;
+    int pawn = us == WHITE ? WP : BP;
+    U64 pieces = pos->bb_color[us] & ~pos->bb_piece[pawn - 1] & ~pos->bb_piece[pawn + 4];
+    return pieces & (att->by_type[us ^ 1][0] | (att->all[us ^ 1] & ~att->all[us]));
+}
+
+/* A node's static eval. exact is false for a lazy score; attacks (squares the opponent attacks)
+ * and threats are only set when maps is true. */
+typedef struct {
+    int score;
+    bool exact;
+    bool maps;
+    U64 attacks;
+    U64 threats;
+} StaticEval;
+
+static void eval_from_cache(const EvalCacheEntry *e, StaticEval *se) {
+    se->score = e->score;
+    se->exact = true;
+    se->maps = true;
+    se->attacks = e->attacks;
+    se->threats = e->threats;
+}
+
+static void eval_to_cache(EvalCacheEntry *e, const Position *pos, int score, const EvalAttacks *att) {
+    e->key = pos->key;
+    e->score = score;
+    e->attacks = att->all[pos->side ^ 1];
+    e->threats = threatened_pieces(pos, att);
+}
+
+static void full_eval(SearchCtx *ctx, const Position *pos, StaticEval *se) {
+    EvalCacheEntry *e = &ctx->eval_cache[pos->key & (EVAL_CACHE_SIZE - 1)];
+    if (e->key == pos->key) {
+        STAT_INC(eval_cache_hits);
+    } else {
+        EvalAttacks att;
+        STAT_INC(evals);
+        eval_to_cache(e, pos, eval_full(pos, &att), &att);
+    }
+    eval_from_cache(e, se);
+}
+
+static int cached_eval(SearchCtx *ctx, const Position *pos) {
+    StaticEval se;
+    full_eval(ctx, pos, &se);
+    return se.score;
+}
+
+/* Tries the eval cache, then the static eval stored in the TT entry, then a lazy eval that may
+ * stop at material and tables when the window is far away. */
+static void static_eval(SearchCtx *ctx, const Position *pos, const TTEntry *tt, int alpha, int beta,
+                        StaticEval *se) {
+    EvalCacheEntry *e = &ctx->eval_cache[pos->key & (EVAL_CACHE_SIZE - 1)];
+    if (e->key == pos->key) {
+        STAT_INC(eval_cache_hits);
+        eval_from_cache(e, se);
+        return;
+    }
+    se->maps = false;
+    se->exact = true;
+    if (tt && tt->eval != TT_EVAL_NONE) {
+        STAT_INC(eval_tt_hits);
+        se->score = tt->eval;
+        return;
+    }
+    EvalAttacks att;
+    bool full = true;
+    se->score = eval_lazy(pos, alpha, beta, &att, &full);
+    if (!full) {
+        STAT_INC(evals_lazy);
+        se->exact = false;
+        return;
+    }
+    STAT_INC(evals);
+    eval_to_cache(e, pos, se->score, &att);
+    eval_from_cache(e, se);
+}
+
+/* SEE from the attack maps: a capture onto a square the opponent defends loses material when
+ * the capturing piece is worth more than its victim. */
+static bool capture_loses(const Position *pos, const StaticEval *se, Move mv) {
+    static const int val[13] = {0, 1, 3, 3, 5, 9, 10, 1, 3, 3, 5, 9, 10};
+    if (M_FLAGS(mv) & (FLAG_PROMO | FLAG_EP)) return false;
+    int to = M_TO(mv);
+    if (val[M_PIECE(mv)] <= val[pos->piece_on[to]]) return false;
+    return se->maps ? (se->attacks >> to) & 1 : is_square_attacked(pos, to, pos->side ^ 1);
+}
+
+static int victim_type(Move mv) {
+    Piece cap = M_CAP(mv);
+    if (cap == EMPTY) return 0;
+    return ((int)cap - 1) % 6;
+}
+
+static int stat_bonus(int depth) {
+    int b = 16 * depth * depth + 32 * depth;
+    return b > 1536 ? 1536 : b;
+}
+
+static void hist_update(int *entry, int bonus) {
+    int abs_bonus = bonus < 0 ? -bonus : bonus;
+    *entry += bonus - *entry * abs_bonus / HIST_MAX;
+}
+
+static void hist_update16(int16_t *entry, int bonus) {
+    int v = *entry;
+    hist_update(&v, bonus);
+    *entry = (int16_t)v;
+}
+
+static Move prev_move(const SearchCtx *ctx, int ply, int back) {
+    return ply >= back ? ctx->stack[ply - back] : 0;
+}
+
+static int quiet_score(const SearchCtx *ctx, Move mv, int ply) {
+    int pc = (int)M_PIECE(mv) - 1;
+    int to = M_TO(mv);
+    int score = ctx->history[pc][to];
+    for (int k = 0; k < 2; ++k) {
+        Move prev = prev_move(ctx, ply, k + 1);
+        if (prev) score += ctx->cont_hist[k][M_PIECE(prev) - 1][M_TO(prev)][pc][to];
+    }
+    return score;
+}
+
+static int score_move(const SearchCtx *ctx, Move mv, Move tt_move, Move counter, int ply) {
     if (mv == tt_move) return 1000000;
     Piece cap = M_CAP(mv);
     if (M_FLAGS(mv) & FLAG_CAPTURE) {
-        return 900000 + mvv_lva(M_PIECE(mv), cap == EMPTY ? WP : cap);
+        return 900000 + mvv_lva(M_PIECE(mv), cap == EMPTY ? WP : cap) * 1024
+            + ctx->capture_hist[M_PIECE(mv) - 1][M_TO(mv)][victim_type(mv)] / 32;
     }
     if (ctx->killer[ply][0] == (int)mv) return 800000;
     if (ctx->killer[ply][1] == (int)mv) return 799000;
-    return ctx->history[M_PIECE(mv) - 1][M_TO(mv)];
+    if (mv == counter) return 798000;
+    return quiet_score(ctx, mv, ply);
 }
 
 static void sort_moves(SearchCtx *ctx, MoveList *list, Move tt_move, int ply) {
+    int scores[MAX_MOVES];
+    Move prev = prev_move(ctx, ply, 1);
+    Move counter = prev ? ctx->countermove[M_PIECE(prev) - 1][M_TO(prev)] : 0;
     for (int i = 0; i < list->n; ++i) {
-        for (int j = i + 1; j < list->n; ++j) {
-            int si = score_move(ctx, list->m[i], tt_move, ply);
-            int sj = score_move(ctx, list->m[j], tt_move, ply);
-            if (sj > si) {
-                Move tmp = list->m[i];
-                list->m[i] = list->m[j];
-                list->m[j] = tmp;
-            }
+        scores[i] = score_move(ctx, list->m[i], tt_move, counter, ply);
+    }
+    for (int i = 1; i < list->n; ++i) {
+        Move mv = list->m[i];
+        int sc = scores[i];
+        int j = i - 1;
+        while (j >= 0 && scores[j] < sc) {
+            list->m[j + 1] = list->m[j];
+            scores[j + 1] = scores[j];
+            --j;
         }
+        list->m[j + 1] = mv;
+        scores[j + 1] = sc;
     }
 }
 
-static int qsearch(SearchCtx *ctx, Position *pos, int alpha, int beta, int ply) {
-    if (time_up()) return eval(pos);
-    CURRENT_LIMITS.nodes++;
+static void update_quiet_stats(SearchCtx *ctx, Move mv, int ply, int bonus) {
+    int pc = (int)M_PIECE(mv) - 1;
+    int to = M_TO(mv);
+    hist_update(&ctx->history[pc][to], bonus);
+    for (int k = 0; k < 2; ++k) {
+        Move prev = prev_move(ctx, ply, k + 1);
+        if (prev) hist_update16(&ctx->cont_hist[k][M_PIECE(prev) - 1][M_TO(prev)][pc][to], bonus);
+    }
+}
+
+static void update_capture_stats(SearchCtx *ctx, Move mv, int bonus) {
+    hist_update(&ctx->capture_hist[M_PIECE(mv) - 1][M_TO(mv)][victim_type(mv)], bonus);
+}
 
-    int stand_pat = eval(pos);
-    if (stand_pat >= beta) return beta;
-    if (stand_pat > alpha) alpha = stand_pat;
+static void update_cutoff_stats(SearchCtx *ctx, Move best, int depth, int ply,
+                                const Move *quiets, int n_quiets,
+                                const Move *captures, int n_captures) {
+    int bonus = stat_bonus(depth);
+    if (!(M_FLAGS(best) & FLAG_CAPTURE)) {
+        if (ctx->killer[ply][0] != (int)best) {
+            ctx->killer[ply][1] = ctx->killer[ply][0];
+            ctx->killer[ply][0] = (int)best;
+        }
+        Move prev = prev_move(ctx, ply, 1);
+        if (prev) ctx->countermove[M_PIECE(prev) - 1][M_TO(prev)] = best;
+        update_quiet_stats(ctx, best, ply, bonus);
+        for (int i = 0; i < n_quiets; ++i) update_quiet_stats(ctx, quiets[i], ply, -bonus);
+    } else {
+        update_capture_stats(ctx, best, bonus);
+    }
+    for (int i = 0; i < n_captures; ++i) update_capture_stats(ctx, captures[i], -bonus);
+}
+
+static int tb_score(int wdl, int ply) {
+    if (wdl > TB_CURSED_WIN) return MATE - MAX_PLY - 1 - ply;
+    if (wdl < TB_BLESSED_LOSS) return -MATE + MAX_PLY + 1 + ply;
+    return 0;
+}
+
+static bool root_allowed(const SearchCtx *ctx, Move mv) {
+    for (int i = 0; i < ctx->n_root_moves; ++i) {
+        if (ctx->root_moves[i] == mv) return true;
+    }
+    return false;
+}
+
+static int score_to_tt(int score, int ply) {
+    if (score >= MATE - MAX_PLY) return score + ply;
+    if (score <= -MATE + MAX_PLY) return score - ply;
+    return score;
+}
+
+static int score_from_tt(int score, int ply) {
+    if (score >= MATE - MAX_PLY) return score - ply;
+    if (score <= -MATE + MAX_PLY) return score + ply;
+    return score;
+}
+
+static int qsearch(SearchCtx *ctx, Position *pos, int alpha, int beta, int ply);
+
+static int qsearch_node(SearchCtx *ctx, Position *pos, int alpha, int beta, int ply, TraceRecord *tr) {
+    if (time_up(ctx)) {
+        TRACE_MARK(tr, prune, PRUNE_STOPPED);
+        return cached_eval(ctx, pos);
+    }
+    ctx->lim.nodes++;
+    STAT_INC(qsearch_nodes);
+    if (ply >= MAX_PLY - 1) {
+        TRACE_MARK(tr, prune, PRUNE_MAX_PLY);
+        return cached_eval(ctx, pos);
+    }
+
+    int alpha_orig = alpha;
+
+    TTEntry *entry = tt_probe(&ctx->tt, pos->key);
+    const TTEntry *tt_hit = NULL;
+    Move tt_move = 0;
+    if (entry && entry->key16 == tt_key16(pos->key) && entry->flag != TT_EMPTY) {
+        tt_hit = entry;
+        tt_move = entry->move32;
+        TRACE_FLAG(tr, TRACE_TT_HIT);
+        int tt_score = score_from_tt(entry->score, ply);
+        if (entry->flag == TT_EXACT || (entry->flag == TT_LOWER && tt_score >= beta)
+            || (entry->flag == TT_UPPER && tt_score <= alpha)) {
+            STAT_INC(tt_cutoffs);
+            TRACE_FLAG(tr, TRACE_TT_CUT);
+            TRACE_MARK(tr, prune, PRUNE_TT);
+            return tt_score;
+        }
+    }
+
+    bool checked = in_check(pos, pos->side);
+    if (checked) TRACE_FLAG(tr, TRACE_IN_CHECK);
+    int best_score = -INF;
+    int tt_eval = TT_EVAL_NONE;
+    StaticEval se;
+    if (!checked) {
+        static_eval(ctx, pos, tt_hit, alpha, beta, &se);
+        if (se.exact) tt_eval = se.score;
+        best_score = se.score;
+        if (best_score >= beta) {
+            tt_store(&ctx->tt, pos->key, 0, score_to_tt(best_score, ply), TT_LOWER, 0, tt_eval);
+            TRACE_MARK(tr, prune, PRUNE_STAND_PAT);
+            return best_score;
+        }
+        if (best_score > alpha) alpha = best_score;
+    }
 
     MoveList list;
     gen_pseudo_legal(pos, &list);
+    if (!checked) {
+        int n = 0;
+        for (int i = 0; i < list.n; ++i) {
+            Move mv = list.m[i];
+            if ((M_FLAGS(mv) & FLAG_CAPTURE) && !capture_loses(pos, &se, mv)) list.m[n++] = mv;
+        }
+        list.n = n;
+    }
+    sort_moves(ctx, &list, tt_move, ply);
+
+    Move best_move = 0;
+    int legal_moves = 0;
     for (int i = 0; i < list.n; ++i) {
         Move mv = list.m[i];
-        if (!(M_FLAGS(mv) & FLAG_CAPTURE)) continue;
         if (!make_move(pos, mv)) continue;
+        legal_moves++;
+        ctx->stack[ply] = mv;
         int score = -qsearch(ctx, pos, -beta, -alpha, ply + 1);
         undo_move(pos, mv);
-        if (score >= beta) return beta;
+        if (score > best_score) {
+            best_score = score;
+            best_move = mv;
+        }
         if (score > alpha) alpha = score;
+        if (alpha >= beta) {
+            TRACE_FLAG(tr, TRACE_BETA_CUT);
+            break;
+        }
+    }
+
+    if (checked && legal_moves == 0) {
+        TRACE_MARK(tr, prune, PRUNE_NO_MOVES);
+        return -MATE + ply;
     }
-    return alpha;
+    TRACE_MARK(tr, best, best_move);
+
+    TTFlag flag = TT_EXACT;
+    if (best_score <= alpha_orig) flag = TT_UPPER;
+    else if (best_score >= beta) flag = TT_LOWER;
+    tt_store(&ctx->tt, pos->key, 0, score_to_tt(best_score, ply), flag, best_move, tt_eval);
+
+    return best_score;
 }
 
-static int negamax(SearchCtx *ctx, Position *pos, int depth, int alpha, int beta, int ply) {
-    if (time_up()) return eval(pos);
+static int negamax(SearchCtx *ctx, Position *pos, int depth, int alpha, int beta, int ply);
+
+static int negamax_node(SearchCtx *ctx, Position *pos, int depth, int alpha, int beta, int ply,
+                        TraceRecord *tr) {
+    if (time_up(ctx)) {
+        TRACE_MARK(tr, prune, PRUNE_STOPPED);
+        return cached_eval(ctx, pos);
+    }
     if (depth <= 0) return qsearch(ctx, pos, alpha, beta, ply);
 
-    CURRENT_LIMITS.nodes++;
+    ctx->lim.nodes++;
+    STAT_INC(negamax_nodes);
+    if (ply >= MAX_PLY - 1) {
+        TRACE_MARK(tr, prune, PRUNE_MAX_PLY);
+        return cached_eval(ctx, pos);
+    }
+
+    if (ply > 0) {
+        if (alpha < -MATE + ply) alpha = -MATE + ply;
+        if (beta > MATE - ply - 1) beta = MATE - ply - 1;
+        if (alpha >= beta) {
+            TRACE_MARK(tr, prune, PRUNE_MATE_DISTANCE);
+            return alpha;
+        }
+        int wdl = 0;
+        if (ctx->tb_pieces && popcount64(pos->occ) <= ctx->tb_pieces && tb_probe_wdl(pos, &wdl)) {
+            ctx->tbhits++;
+            TRACE_MARK(tr, prune, PRUNE_TABLEBASE);
+            return tb_score(wdl, ply);
+        }
+        int eg_score = 0;
+        if (endgame_eval(pos, &eg_score) == ENDGAME_EXACT) {
+            TRACE_MARK(tr, prune, PRUNE_ENDGAME);
+            return eg_score;
+        }
+    }
 
     int alpha_orig = alpha;
 
     TTEntry *entry = tt_probe(&ctx->tt, pos->key);
+    const TTEntry *tt_hit = NULL;
     Move tt_move = 0;
-    if (entry && entry->key16 == (uint16_t)pos->key) {
+    if (entry && entry->key16 == tt_key16(pos->key) && entry->flag != TT_EMPTY) {
+        tt_hit = entry;
         tt_move = entry->move32;
+        TRACE_FLAG(tr, TRACE_TT_HIT);
         if (entry->depth >= depth) {
-            int tt_score = entry->score;
-            if (entry->flag == TT_EXACT) return tt_score;
+            int tt_score = score_from_tt(entry->score, ply);
             if (entry->flag == TT_LOWER && tt_score > alpha) alpha = tt_score;
             else if (entry->flag == TT_UPPER && tt_score < beta) beta = tt_score;
-            if (alpha >= beta) return tt_score;
+            if (entry->flag == TT_EXACT || alpha >= beta) {
+                STAT_INC(tt_cutoffs);
+                TRACE_FLAG(tr, TRACE_TT_CUT);
+                TRACE_MARK(tr, prune, PRUNE_TT);
+                return tt_score;
+            }
+        }
+    }
+
+    if (!tt_move && depth >= 4) depth--;
+
+    int tt_eval = TT_EVAL_NONE;
+    if (ply > 0 && depth <= RFP_DEPTH && beta > -MATE + MAX_PLY && beta < MATE - MAX_PLY
+        && !in_check(pos, pos->side)) {
+        int target = beta + RFP_MARGIN * depth;
+        StaticEval se;
+        static_eval(ctx, pos, tt_hit, target - 1, target, &se);
+        if (se.exact) tt_eval = se.score;
+        if (se.score >= target) {
+            if (!se.maps) full_eval(ctx, pos, &se);
+            tt_eval = se.score;
+            if (se.score >= target && !se.threats) {
+                TRACE_MARK(tr, prune, PRUNE_FUTILITY);
+                return se.score;
+            }
         }
     }
 
     MoveList list;
     gen_pseudo_legal(pos, &list);
     if (list.n == 0) {
+        TRACE_MARK(tr, prune, PRUNE_NO_MOVES);
         if (in_check(pos, pos->side)) return -MATE + ply;
         return 0;
     }
@@ -106,11 +448,17 @@ static int negamax(SearchCtx *ctx, Position *pos, int depth, int alpha, int beta
     int best_score = -INF;
     Move best_move = 0;
     int legal_moves = 0;
+    Move quiets[MAX_QUIETS];
+    Move captures[MAX_QUIETS];
+    int n_quiets = 0;
+    int n_captures = 0;
 
     for (int i = 0; i < list.n; ++i) {
         Move mv = list.m[i];
+        if (ply == 0 && ctx->n_root_moves && !root_allowed(ctx, mv)) continue;
         if (!make_move(pos, mv)) continue;
         legal_moves++;
+        ctx->stack[ply] = mv;
         int score = -negamax(ctx, pos, depth - 1, -beta, -alpha, ply + 1);
         undo_move(pos, mv);
 
@@ -118,48 +466,126 @@ static int negamax(SearchCtx *ctx, Position *pos, int depth, int alpha, int beta
             best_score = score;
             best_move = mv;
         }
-        if (score > alpha) {
-            alpha = score;
-            if (!(M_FLAGS(mv) & FLAG_CAPTURE)) {
-                ctx->history[M_PIECE(mv) - 1][M_TO(mv)] += depth * depth;
-            }
-        }
+        if (score > alpha) alpha = score;
         if (alpha >= beta) {
-            if (!(M_FLAGS(mv) & FLAG_CAPTURE)) {
-                ctx->killer[ply][1] = ctx->killer[ply][0];
-                ctx->killer[ply][0] = (int)mv;
-            }
+            ctx->order.cutoffs++;
+            if (legal_moves == 1) ctx->order.first_move_cutoffs++;
+#ifdef STATS
+            STAT_INC(cutoffs);
+            STAT_ADD(cutoff_index_sum, legal_moves - 1);
+            if (legal_moves == 1) STAT_INC(first_move_cutoffs);
+            if (mv == tt_move) STAT_INC(cutoff_tt_move);
+            else if (M_FLAGS(mv) & FLAG_CAPTURE) STAT_INC(cutoff_capture);
+            else if (ctx->killer[ply][0] == (int)mv || ctx->killer[ply][1] == (int)mv) STAT_INC(cutoff_killer);
+            else STAT_INC(cutoff_quiet);
+#endif
+            update_cutoff_stats(ctx, mv, depth, ply, quiets, n_quiets, captures, n_captures);
+            TRACE_FLAG(tr, TRACE_BETA_CUT);
             break;
         }
+        if (M_FLAGS(mv) & FLAG_CAPTURE) {
+            if (n_captures < MAX_QUIETS) captures[n_captures++] = mv;
+        } else if (n_quiets < MAX_QUIETS) {
+            quiets[n_quiets++] = mv;
+        }
     }
 
     if (legal_moves == 0) {
+        TRACE_MARK(tr, prune, PRUNE_NO_MOVES);
         if (in_check(pos, pos->side)) return -MATE + ply;
         return 0;
     }
+    TRACE_MARK(tr, best, best_move);
 
     TTFlag flag = TT_EXACT;
     if (best_score <= alpha_orig) flag = TT_UPPER;
     else if (best_score >= beta) flag = TT_LOWER;
-    tt_store(&ctx->tt, pos->key, depth, best_score, flag, best_move);
+    tt_store(&ctx->tt, pos->key, depth, score_to_tt(best_score, ply), flag, best_move, tt_eval);
 
     return best_score;
 }
 
+static void trace_begin(const SearchCtx *ctx, TraceRecord *rec, const Position *pos,
+                        int depth, int alpha, int beta, int ply) {
+    memset(rec, 0, sizeof(*rec));
+    rec->key = pos->key;
+    rec->move = prev_move(ctx, ply, 1);
+    rec->alpha = trace_clamp(alpha);
+    rec->beta = trace_clamp(beta);
+    rec->search_id = ctx->trace->search_id;
+    rec->ply = (uint8_t)ply;
+    rec->depth = (int8_t)(depth < -128 ? -128 : depth > 127 ? 127 : depth);
+    rec->root_depth = (uint8_t)ctx->root_depth;
+}
+
+static int qsearch(SearchCtx *ctx, Position *pos, int alpha, int beta, int ply) {
+    if (!ctx->trace) return qsearch_node(ctx, pos, alpha, beta, ply, NULL);
+    TraceRecord rec;
+    trace_begin(ctx, &rec, pos, 0, alpha, beta, ply);
+    rec.flags = TRACE_QSEARCH;
+    int score = qsearch_node(ctx, pos, alpha, beta, ply, &rec);
+    rec.score = trace_clamp(score);
+    trace_emit(ctx->trace, &rec);
+    return score;
+}
+
+static int negamax(SearchCtx *ctx, Position *pos, int depth, int alpha, int beta, int ply) {
+    if (!ctx->trace || depth <= 0) return negamax_node(ctx, pos, depth, alpha, beta, ply, NULL);
+    TraceRecord rec;
+    trace_begin(ctx, &rec, pos, depth, alpha, beta, ply);
+    int score = negamax_node(ctx, pos, depth, alpha, beta, ply, &rec);
+    rec.score = trace_clamp(score);
+    trace_emit(ctx->trace, &rec);
+    return score;
+}
+
 void search_init(SearchCtx *ctx, size_t tt_mb) {
     memset(ctx, 0, sizeof(*ctx));
+    engine_init();
     tt_init(&ctx->tt, tt_mb);
-    tables_init();
 }
 
 void search_quit(SearchCtx *ctx) {
     tt_free(&ctx->tt);
 }
 
+void search_clear(SearchCtx *ctx) {
+    tt_clear(&ctx->tt);
+    memset(ctx->killer, 0, sizeof(ctx->killer));
+    memset(ctx->history, 0, sizeof(ctx->history));
+    memset(ctx->countermove, 0, sizeof(ctx->countermove));
+    memset(ctx->cont_hist, 0, sizeof(ctx->cont_hist));
+    memset(ctx->capture_hist, 0, sizeof(ctx->capture_hist));
+    memset(ctx->stack, 0, sizeof(ctx->stack));
+    memset(ctx->eval_cache, 0, sizeof(ctx->eval_cache));
+}
+
+static Move fallback_move(Position *pos) {
+    MoveList list;
+    gen_pseudo_legal(pos, &list);
+    for (int i = 0; i < list.n; ++i) {
+        if (move_is_legal(pos, list.m[i])) return list.m[i];
+    }
+    return 0;
+}
+
 Move search_bestmove(SearchCtx *ctx, Position *pos, const SearchLimits *lim) {
-    CURRENT_LIMITS = *lim;
-    CURRENT_LIMITS.nodes = 0;
-    CURRENT_LIMITS.start_ms = now_ms();
+    ctx->lim = *lim;
+    ctx->lim.nodes = 0;
+    memset(&ctx->order, 0, sizeof(ctx->order));
+    stats_reset();
+    if (ctx->trace) ctx->trace->search_id++;
+    tt_new_search(&ctx->tt);
+    ctx->lim.start_ms = now_ms();
+    ctx->tbhits = 0;
+    tb_acquire();
+    ctx->tb_pieces = ctx->tb_limit < tb_largest() ? ctx->tb_limit : tb_largest();
+    ctx->n_root_moves = 0;
+    if (ctx->tb_pieces && popcount64(pos->occ) <= ctx->tb_pieces) {
+        int wdl = 0;
+        ctx->n_root_moves = tb_root_moves(pos, ctx->root_moves, &wdl);
+        if (ctx->n_root_moves) ctx->tbhits++;
+    }
 
     uint64_t time_budget = 0;
     if (lim->movetime_ms > 0) {
@@ -168,37 +594,63 @@ Move search_bestmove(SearchCtx *ctx, Position *pos, const SearchLimits *lim) {
         int side_time = pos->side == WHITE ? lim->wtime_ms : lim->btime_ms;
         int inc = pos->side == WHITE ? lim->winc_ms : lim->binc_ms;
         time_budget = (uint64_t)(side_time / 25 + inc);
-    } else {
+    } else if (lim->max_depth <= 0 && !lim->max_nodes) {
         time_budget = 1000;
     }
 
-    CURRENT_LIMITS.soft_stop_ms = CURRENT_LIMITS.start_ms + time_budget;
-    CURRENT_LIMITS.hard_stop_ms = CURRENT_LIMITS.start_ms + time_budget + 50;
+    if (time_budget) {
+        ctx->lim.soft_stop_ms = ctx->lim.start_ms + time_budget;
+        ctx->lim.hard_stop_ms = ctx->lim.start_ms + time_budget + 50;
+    } else {
+        ctx->lim.soft_stop_ms = 0;
+        ctx->lim.hard_stop_ms = 0;
+    }
 
     Move best = 0;
     int best_score = -INF;
-    int max_depth = lim->max_depth > 0 ? lim->max_depth : 5;
+    int max_depth = lim->max_depth > 0 ? lim->max_depth : lim->max_nodes ? MAX_PLY - 1 : 5;
 
     int window = 30;
     int alpha = -INF;
     int beta = INF;
 
     for (int depth = 1; depth <= max_depth; ++depth) {
+        ctx->root_depth = depth;
         int score = negamax(ctx, pos, depth, alpha, beta, 0);
-        if (time_up()) break;
+        if (time_up(ctx)) break;
         if (score <= alpha || score >= beta) {
             alpha = -INF;
             beta = INF;
             score = negamax(ctx, pos, depth, alpha, beta, 0);
+            if (time_up(ctx)) break;
         }
         best_score = score;
+#ifdef STATS
+        if (depth < STATS_MAX_DEPTH) {
+            search_stats.iter_nodes[depth] = ctx->lim.nodes;
+            search_stats.iterations = depth;
+        }
+#endif
         TTEntry *e = tt_probe(&ctx->tt, pos->key);
-        if (e && e->key16 == (uint16_t)pos->key) {
+        if (e && e->key16 == tt_key16(pos->key)) {
             best = e->move32;
         }
+        if (ctx->on_info) {
+            SearchInfo info;
+            info.depth = depth;
+            info.score = best_score;
+            info.nodes = ctx->lim.nodes;
+            info.time_ms = now_ms() - ctx->lim.start_ms;
+            info.tbhits = ctx->tbhits;
+            info.best = best;
+            ctx->on_info(&info, ctx->on_info_user);
+        }
         alpha = best_score - window;
         beta = best_score + window;
     }
 
+    tb_release();
+    if (!best) best = fallback_move(pos);
+    if (ctx->trace) trace_flush(ctx->trace);
     return best;
 }
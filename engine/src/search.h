@@ -1,25 +1,73 @@
 #pragma once
 #include "position.h"
+#include "movegen.h"
 #include "tt.h"
+#include "trace.h"
+
+#define INF 32000
+#define MATE 30000
+#define EVAL_CACHE_SIZE 8192
+
+/* Full static evals keyed by Zobrist key, with the attack bits search needs from the maps. */
+typedef struct {
+    uint64_t key;
+    U64 attacks;
+    U64 threats;
+    int32_t score;
+} EvalCacheEntry;
 
 typedef struct {
     int max_depth;
     int movetime_ms;
     int wtime_ms, btime_ms, winc_ms, binc_ms;
-    int stop;
+    uint64_t max_nodes;
+    volatile int stop;
     uint64_t nodes;
     uint64_t start_ms;
     uint64_t hard_stop_ms;
     uint64_t soft_stop_ms;
 } SearchLimits;
 
+typedef struct {
+    uint64_t cutoffs;
+    uint64_t first_move_cutoffs;
+} OrderStats;
+
+typedef struct {
+    int depth;
+    int score;
+    uint64_t nodes;
+    uint64_t time_ms;
+    uint64_t tbhits;
+    Move best;
+} SearchInfo;
+
+typedef void (*SearchInfoFn)(const SearchInfo *info, void *user);
+
 typedef struct {
     TT tt;
+    SearchLimits lim;
     int killer[MAX_PLY][2];
     int history[12][64];
+    Move countermove[12][64];
+    int16_t cont_hist[2][12][64][12][64];
+    int capture_hist[12][64][6];
+    Move stack[MAX_PLY];
+    OrderStats order;
+    SearchInfoFn on_info;
+    void *on_info_user;
+    TraceWriter *trace;
+    int root_depth;
+    int tb_limit;
+    int tb_pieces;
+    uint64_t tbhits;
+    Move root_moves[MAX_MOVES];
+    int n_root_moves;
+    EvalCacheEntry eval_cache[EVAL_CACHE_SIZE];
 } SearchCtx;
 
 void search_init(SearchCtx *ctx, size_t tt_mb);
 void search_quit(SearchCtx *ctx);
+void search_clear(SearchCtx *ctx);
 
 Move search_bestmove(SearchCtx *ctx, Position *pos, const SearchLimits *lim);
@@ -0,0 +1,61 @@
+#include <stdio.h>
+#include <string.h>
+#include "stats.h"
+
+#ifdef STATS
+_Thread_local SearchStats search_stats;
+
+void stats_reset(void) {
+    memset(&search_stats, 0, sizeof(search_stats));
+}
+
+void stats_snapshot(SearchStats *out) {
+    *out = search_stats;
+}
+
+static double pct(uint64_t num, uint64_t den) {
+    return den ? 100.0 * (double)num / (double)den : 0.0;
+}
+
+void stats_print(const SearchStats *s) {
+    uint64_t nodes = s->negamax_nodes + s->qsearch_nodes;
+    printf("info string stats nodes %llu negamax %llu qsearch %llu qsearch_share %.1f%%\n",
+           (unsigned long long)nodes, (unsigned long long)s->negamax_nodes,
+           (unsigned long long)s->qsearch_nodes, pct(s->qsearch_nodes, nodes));
+    printf("info string stats tt probes %llu hits %llu (%.1f%%) cutoffs %llu stores %llu\n",
+           (unsigned long long)s->tt_probes, (unsigned long long)s->tt_hits,
+           pct(s->tt_hits, s->tt_probes), (unsigned long long)s->tt_cutoffs,
+           (unsigned long long)s->tt_stores);
+    printf("info string stats make %llu illegal %llu (%.1f%%)\n",
+           (unsigned long long)s->moves_made, (unsigned long long)s->moves_illegal,
+           pct(s->moves_illegal, s->moves_made));
+    printf("info string stats cutoffs %llu first %.1f%% avg_index %.2f tt %.1f%% capture %.1f%% killer %.1f%% quiet %.1f%%\n",
+           (unsigned long long)s->cutoffs, pct(s->first_move_cutoffs, s->cutoffs),
+           s->cutoffs ? (double)s->cutoff_index_sum / (double)s->cutoffs : 0.0,
+           pct(s->cutoff_tt_move, s->cutoffs), pct(s->cutoff_capture, s->cutoffs),
+           pct(s->cutoff_killer, s->cutoffs), pct(s->cutoff_quiet, s->cutoffs));
+    printf("info string stats eval full %llu lazy %llu cache_hits %llu tt_hits %llu\n",
+           (unsigned long long)s->evals, (unsigned long long)s->evals_lazy,
+           (unsigned long long)s->eval_cache_hits, (unsigned long long)s->eval_tt_hits);
+    for (int d = 1; d <= s->iterations && d < STATS_MAX_DEPTH; ++d) {
+        uint64_t prev = s->iter_nodes[d - 1];
+        printf("info string stats depth %d nodes %llu ebf %.2f\n", d,
+               (unsigned long long)s->iter_nodes[d],
+               d > 1 && prev ? (double)s->iter_nodes[d] / (double)prev : 0.0);
+    }
+    fflush(stdout);
+}
+#else
+void stats_reset(void) {
+}
+
+void stats_snapshot(SearchStats *out) {
+    memset(out, 0, sizeof(*out));
+}
+
+void stats_print(const SearchStats *s) {
+    (void)s;
+    printf("info string stats not compiled in, rebuild with make STATS=1\n");
+    fflush(stdout);
+}
+#endif
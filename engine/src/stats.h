@@ -0,0 +1,41 @@
+#pragma once
+#include <stdint.h>
+
+#define STATS_MAX_DEPTH 64
+
+typedef struct {
+    uint64_t negamax_nodes;
+    uint64_t qsearch_nodes;
+    uint64_t tt_probes;
+    uint64_t tt_hits;
+    uint64_t tt_cutoffs;
+    uint64_t tt_stores;
+    uint64_t moves_made;
+    uint64_t moves_illegal;
+    uint64_t cutoffs;
+    uint64_t first_move_cutoffs;
+    uint64_t cutoff_index_sum;
+    uint64_t cutoff_tt_move;
+    uint64_t cutoff_capture;
+    uint64_t cutoff_killer;
+    uint64_t cutoff_quiet;
+    uint64_t evals;
+    uint64_t evals_lazy;
+    uint64_t eval_cache_hits;
+    uint64_t eval_tt_hits;
+    uint64_t iter_nodes[STATS_MAX_DEPTH];
+    int iterations;
+} SearchStats;
+
+#ifdef STATS
+extern _Thread_local SearchStats search_stats;
+#define STAT_INC(field) (search_stats.field++)
+#define STAT_ADD(field, n) (search_stats.field += (uint64_t)(n))
+#else
+#define STAT_INC(field) ((void)0)
+#define STAT_ADD(field, n) ((void)0)
+#endif
+
+void stats_reset(void);
+void stats_snapshot(SearchStats *out);
+void stats_print(const SearchStats *s);
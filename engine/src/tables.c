@@ -3,6 +3,15 @@
 U64 KNIGHT_ATTACKS[64];
 U64 KING_ATTACKS[64];
 U64 PAWN_ATTACKS[2][64];
+U64 BISHOP_RAYS[64];
+U64 ROOK_RAYS[64];
+U64 BETWEEN[64][64];
+U64 LINE[64][64];
+
+enum { DIR_N, DIR_NE, DIR_NW, DIR_E, DIR_S, DIR_SW, DIR_SE, DIR_W };
+static const int DIR_FILE[8] = {0, 1, -1, 1, 0, -1, 1, -1};
+static const int DIR_RANK[8] = {1, 1, 1, 0, -1, -1, -1, 0};
+static U64 RAYS[8][64];
 
 static inline int on_board(int file, int rank) {
     return file >= 0 && file < 8 && rank >= 0 && rank < 8;
@@ -44,59 +53,52 @@ void tables_init(void) {
         if (on_board(file + 1, rank - 1)) bp |= 1ULL << ((rank - 1) * 8 + (file + 1));
         PAWN_ATTACKS[WHITE][sq] = wp;
         PAWN_ATTACKS[BLACK][sq] = bp;
-    }
-}
 
-U64 rook_attacks(int sq, U64 occ) {
-    U64 attacks = 0;
-    int file = sq & 7;
-    int rank = sq >> 3;
-    for (int r = rank + 1; r < 8; ++r) {
-        int s = r * 8 + file;
-        attacks |= 1ULL << s;
-        if (occ & (1ULL << s)) break;
-    }
-    for (int r = rank - 1; r >= 0; --r) {
-        int s = r * 8 + file;
-        attacks |= 1ULL << s;
-        if (occ & (1ULL << s)) break;
+        for (int dir = 0; dir < 8; ++dir) {
+            U64 ray = 0;
+            for (int f = file + DIR_FILE[dir], r = rank + DIR_RANK[dir]; on_board(f, r);
+                 f += DIR_FILE[dir], r += DIR_RANK[dir]) {
+                ray |= 1ULL << (r * 8 + f);
+            }
+            RAYS[dir][sq] = ray;
+        }
     }
-    for (int f = file + 1; f < 8; ++f) {
-        int s = rank * 8 + f;
-        attacks |= 1ULL << s;
-        if (occ & (1ULL << s)) break;
+
+    for (int a = 0; a < 64; ++a) {
+        BISHOP_RAYS[a] = bishop_attacks(a, 0);
+        ROOK_RAYS[a] = rook_attacks(a, 0);
     }
-    for (int f = file - 1; f >= 0; --f) {
-        int s = rank * 8 + f;
-        attacks |= 1ULL << s;
-        if (occ & (1ULL << s)) break;
+    for (int a = 0; a < 64; ++a) {
+        for (int b = 0; b < 64; ++b) {
+            U64 ab = (1ULL << a) | (1ULL << b);
+            BETWEEN[a][b] = 0;
+            LINE[a][b] = 0;
+            if (a == b) continue;
+            if (BISHOP_RAYS[a] & (1ULL << b)) {
+                BETWEEN[a][b] = bishop_attacks(a, ab) & bishop_attacks(b, ab);
+                LINE[a][b] = (BISHOP_RAYS[a] & BISHOP_RAYS[b]) | ab;
+            } else if (ROOK_RAYS[a] & (1ULL << b)) {
+                BETWEEN[a][b] = rook_attacks(a, ab) & rook_attacks(b, ab);
+                LINE[a][b] = (ROOK_RAYS[a] & ROOK_RAYS[b]) | ab;
+            }
+        }
     }
-    return attacks;
+}
+
+/* Directions 0-3 step towards higher squares, so their first blocker is the lowest set bit. */
+static inline U64 ray_attacks(int dir, int sq, U64 occ) {
+    U64 ray = RAYS[dir][sq];
+    U64 blockers = ray & occ;
+    if (blockers) ray ^= RAYS[dir][dir < 4 ? lsb_index(blockers) : msb_index(blockers)];
+    return ray;
+}
+
+U64 rook_attacks(int sq, U64 occ) {
+    return ray_attacks(DIR_N, sq, occ) | ray_attacks(DIR_E, sq, occ)
+         | ray_attacks(DIR_S, sq, occ) | ray_attacks(DIR_W, sq, occ);
 }
 
 U64 bishop_attacks(int sq, U64 occ) {
-    U64 attacks = 0;
-    int file = sq & 7;
-    int rank = sq >> 3;
-    for (int f = file + 1, r = rank + 1; f < 8 && r < 8; ++f, ++r) {
-        int s = r * 8 + f;
-        attacks |= 1ULL << s;
-        if (occ & (1ULL << s)) break;
-    }
-    for (int f = file - 1, r = rank + 1; f >= 0 && r < 8; --f, ++r) {
-        int s = r * 8 + f;
-        attacks |= 1ULL << s;
-        if (occ & (1ULL << s)) break;
-    }
-    for (int f = file + 1, r = rank - 1; f < 8 && r >= 0; ++f, --r) {
-        int s = r * 8 + f;
-        attacks |= 1ULL << s;
-        if (occ & (1ULL << s)) break;
-    }
-    for (int f = file - 1, r = rank - 1; f >= 0 && r >= 0; --f, --r) {
-        int s = r * 8 + f;
-        attacks |= 1ULL << s;
-        if (occ & (1ULL << s)) break;
-    }
-    return attacks;
+    return ray_attacks(DIR_NE, sq, occ) | ray_attacks(DIR_NW, sq, occ)
+         | ray_attacks(DIR_SE, sq, occ) | ray_attacks(DIR_SW, sq, occ);
 }
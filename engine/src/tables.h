@@ -4,6 +4,12 @@
 extern U64 KNIGHT_ATTACKS[64];
 extern U64 KING_ATTACKS[64];
 extern U64 PAWN_ATTACKS[2][64];
+extern U64 BISHOP_RAYS[64];
+extern U64 ROOK_RAYS[64];
+/* BETWEEN holds the squares strictly between two aligned squares, LINE the whole line through
+ * them; both are empty for squares that share no rank, file or diagonal. */
+extern U64 BETWEEN[64][64];
+extern U64 LINE[64][64];
 
 void tables_init(void);
 U64 rook_attacks(int sq, U64 occ);
@@ -0,0 +1,945 @@
+#define _POSIX_C_SOURCE 200809L
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "tb.h"
+#include "make.h"
+#include "tables.h"
+
+#define TB_PATH_MAX 4096
+#define TB_HASH_SIZE 4096
+#define TB_MAX_SYM_LEN 32
+#define TB_MAX_DTZ (1 << 18)
+
+/* Per-table flags in the file header, and per-pairs flags of each (file, side) block. */
+enum { TB_SPLIT = 1, TB_HAS_PAWNS = 2 };
+enum {
+    TB_FLAG_STM = 1,
+    TB_FLAG_MAPPED = 2,
+    TB_FLAG_WIN_PLIES = 4,
+    TB_FLAG_LOSS_PLIES = 8,
+    TB_FLAG_WIDE = 16,
+    TB_FLAG_SINGLE_VALUE = 128
+};
+
+enum { PROBE_FAIL, PROBE_OK, PROBE_CHANGE_STM, PROBE_ZEROING };
+
+/* One compressed value stream: the pieces order and group layout used to index it, and the
+ * canonical Huffman code plus Re-Pair symbol tree that expand it. */
+typedef struct {
+    uint8_t flags;
+    uint8_t min_sym_len;
+    uint8_t pieces[TB_MAX_PIECES];
+    uint8_t group_len[TB_MAX_PIECES + 1];
+    uint64_t group_idx[TB_MAX_PIECES + 1];
+    uint64_t block_size;
+    uint64_t span;
+    uint64_t sparse_size;
+    uint32_t n_blocks;
+    uint32_t block_len_size;
+    int n_syms;
+    const uint8_t *sparse;
+    const uint8_t *block_len;
+    const uint8_t *data;
+    const uint8_t *lowest_sym;
+    const uint8_t *btree;
+    uint8_t *symlen;
+    uint64_t base64[TB_MAX_SYM_LEN];
+    uint16_t map_idx[4];
+} TbPairs;
+
+typedef struct {
+    const uint8_t *data;
+    const uint8_t *end;
+    size_t size;
+    const uint8_t *map;
+    TbPairs pairs[4][2];
+} TbFile;
+
+typedef struct {
+    uint64_t mat_key[2];
+    int pieces;
+    bool has_pawns;
+    bool unique_pieces;
+    int pawn_count[2];
+    TbFile wdl;
+    TbFile dtz;
+} TbTable;
+
+typedef struct {
+    uint64_t key;
+    TbTable *table;
+} TbSlot;
+
+static const uint8_t WDL_MAGIC[4] = {0x71, 0xe8, 0x23, 0x5d};
+static const uint8_t DTZ_MAGIC[4] = {0xd7, 0x66, 0x0c, 0xa5};
+
+/* Searches hold the read side for as long as they may probe; tb_init() only swaps the tables
+ * when it gets the write side without waiting. */
+static pthread_rwlock_t TB_LOCK = PTHREAD_RWLOCK_INITIALIZER;
+static TbTable TABLES[TB_MAX_TABLES];
+static TbSlot INDEX[TB_HASH_SIZE];
+static int N_TABLES;
+static int LARGEST;
+static char LOADED_PATHS[TB_PATH_MAX];
+
+static bool MAPS_READY;
+static int MAP_B1H1H7[64];
+static int MAP_A1D1D4[64];
+static int MAP_KK[10][64];
+static int MAP_PAWNS[64];
+static uint64_t BINOMIAL[6][64];
+static uint64_t LEAD_PAWN_IDX[6][64];
+static uint64_t LEAD_PAWNS_SIZE[6][4];
+
+static const uint64_t KVK_KEY = MAT_KEY(WK) + MAT_KEY(BK);
+
+static inline int sq_file(int sq) { return sq & 7; }
+static inline int sq_rank(int sq) { return sq >> 3; }
+static inline int off_a1h8(int sq) { return sq_rank(sq) - sq_file(sq); }
+
+static inline uint32_t le16(const uint8_t *p) { return (uint32_t)p[0] | (uint32_t)p[1] << 8; }
+static inline uint32_t le32(const uint8_t *p) { return le16(p) | le16(p + 2) << 16; }
+
+static inline uint32_t be32(const uint8_t *p, const uint8_t *end) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v = v << 8 | (p + i < end ? p[i] : 0);
+    return v;
+}
+
+static inline int lr_left(const uint8_t *lr) { return (lr[1] & 0xF) << 8 | lr[0]; }
+static inline int lr_right(const uint8_t *lr) { return lr[2] << 4 | lr[1] >> 4; }
+
+/* Syzygy piece codes are color * 8 + type with P..K = 1..6, the same type order as Piece. */
+static inline int tb_code(Piece p) {
+    return p >= BP ? (int)p - BP + 9 : (int)p;
+}
+
+static inline Piece tb_piece(int code) {
+    return (Piece)((code & 8) ? (code & 7) + BP - 1 : code & 7);
+}
+
+static inline int sign_of(int v) { return (v > 0) - (v < 0); }
+
+static void init_maps(void) {
+    int code = 0;
+    for (int sq = 0; sq < 64; ++sq) {
+        if (off_a1h8(sq) < 0) MAP_B1H1H7[sq] = code++;
+    }
+    int diagonal[4];
+    int n_diagonal = 0;
+    code = 0;
+    for (int sq = 0; sq <= 27; ++sq) {
+        if (off_a1h8(sq) < 0 && sq_file(sq) <= 3) MAP_A1D1D4[sq] = code++;
+        else if (!off_a1h8(sq) && sq_file(sq) <= 3) diagonal[n_diagonal++] = sq;
+    }
+    for (int i = 0; i < n_diagonal; ++i) MAP_A1D1D4[diagonal[i]] = code++;
+
+    int both_idx[64];
+    int both_sq[64];
+    int n_both = 0;
+    code = 0;
+    for (int idx = 0; idx < 10; ++idx) {
+        for (int s1 = 0; s1 <= 27; ++s1) {
+            if (MAP_A1D1D4[s1] != idx || (!idx && s1 != 1)) continue;
+            for (int s2 = 0; s2 < 64; ++s2) {
+                if ((KING_ATTACKS[s1] | 1ULL << s1) & 1ULL << s2) continue;
+                if (!off_a1h8(s1) && off_a1h8(s2) > 0) continue;
+                if (!off_a1h8(s1) && !off_a1h8(s2)) {
+                    both_idx[n_both] = idx;
+                    both_sq[n_both++] = s2;
+                } else {
+                    MAP_KK[idx][s2] = code++;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < n_both; ++i) MAP_KK[both_idx[i]][both_sq[i]] = code++;
+
+    BINOMIAL[0][0] = 1;
+    for (int n = 1; n < 64; ++n) {
+        for (int k = 0; k < 6 && k <= n; ++k) {
+            BINOMIAL[k][n] = (k > 0 ? BINOMIAL[k - 1][n - 1] : 0) + (k < n ? BINOMIAL[k][n - 1] : 0);
+        }
+    }
+
+    /* MapPawns numbers a2-h7 from 47 down, edge files and low ranks first, so the leading pawn
+     * is the one with the highest value. */
+    int available = 47;
+    for (int lead = 1; lead <= 5; ++lead) {
+        for (int f = 0; f < 4; ++f) {
+            uint64_t idx = 0;
+            for (int r = 1; r <= 6; ++r) {
+                int sq = r * 8 + f;
+                if (lead == 1) {
+                    MAP_PAWNS[sq] = available--;
+                    MAP_PAWNS[sq ^ 7] = available--;
+                }
+                LEAD_PAWN_IDX[lead][sq] = idx;
+                idx += BINOMIAL[lead - 1][MAP_PAWNS[sq]];
+            }
+            LEAD_PAWNS_SIZE[lead][f] = idx;
+        }
+    }
+    MAPS_READY = true;
+}
+
+static inline size_t slot_of(uint64_t key) {
+    return (size_t)((key * 0x9e3779b97f4a7c15ULL) >> 52) & (TB_HASH_SIZE - 1);
+}
+
+static void index_insert(uint64_t key, TbTable *t) {
+    size_t i = slot_of(key);
+    while (INDEX[i].key && INDEX[i].key != key) i = (i + 1) & (TB_HASH_SIZE - 1);
+    INDEX[i].key = key;
+    INDEX[i].table = t;
+}
+
+static TbTable *find_table(uint64_t mat_key) {
+    for (size_t i = slot_of(mat_key); INDEX[i].key; i = (i + 1) & (TB_HASH_SIZE - 1)) {
+        if (INDEX[i].key == mat_key) return INDEX[i].table;
+    }
+    return NULL;
+}
+
+static bool map_file(const char *path, const uint8_t *magic, TbFile *out) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 16) {
+        close(fd);
+        return false;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    if (memcmp(data, magic, 4) != 0) {
+        munmap(data, (size_t)st.st_size);
+        return false;
+    }
+    out->data = (const uint8_t *)data;
+    out->size = (size_t)st.st_size;
+    out->end = out->data + out->size;
+    return true;
+}
+
+static void unmap_file(TbFile *f) {
+    for (int i = 0; i < 4; ++i) {
+        free(f->pairs[i][0].symlen);
+        free(f->pairs[i][1].symlen);
+    }
+    if (f->data) munmap((void *)f->data, f->size);
+    memset(f, 0, sizeof(*f));
+}
+
+static inline bool in_file(const TbFile *f, const uint8_t *p, uint64_t n) {
+    return p >= f->data && p <= f->end && n <= (uint64_t)(f->end - p);
+}
+
+static void set_groups(const TbTable *t, TbPairs *d, const int order[2], int file) {
+    int n = 0;
+    int first_len = t->has_pawns ? 0 : t->unique_pieces ? 3 : 2;
+    d->group_len[n] = 1;
+    for (int i = 1; i < t->pieces; ++i) {
+        if (--first_len > 0 || d->pieces[i] == d->pieces[i - 1]) d->group_len[n]++;
+        else d->group_len[++n] = 1;
+    }
+    d->group_len[++n] = 0;
+
+    bool pp = t->has_pawns && t->pawn_count[1];
+    int next = pp ? 2 : 1;
+    int free_squares = 64 - d->group_len[0] - (pp ? d->group_len[1] : 0);
+    uint64_t idx = 1;
+    for (int k = 0; next < n || k == order[0] || k == order[1]; ++k) {
+        if (k == order[0]) {
+            d->group_idx[0] = idx;
+            idx *= t->has_pawns ? LEAD_PAWNS_SIZE[d->group_len[0]][file] : t->unique_pieces ? 31332 : 462;
+        } else if (k == order[1]) {
+            d->group_idx[1] = idx;
+            idx *= BINOMIAL[d->group_len[1]][48 - d->group_len[0]];
+        } else {
+            d->group_idx[next] = idx;
+            idx *= BINOMIAL[d->group_len[next]][free_squares];
+            free_squares -= d->group_len[next++];
+        }
+    }
+    d->group_idx[n] = idx;
+}
+
+static bool set_symlen(TbPairs *d, int sym, uint8_t *visited) {
+    visited[sym] = 1;
+    const uint8_t *lr = d->btree + 3 * sym;
+    int right = lr_right(lr);
+    if (right == 0xFFF) return true;
+    int left = lr_left(lr);
+    if (left >= d->n_syms || right >= d->n_syms) return false;
+    if (!visited[left] && !set_symlen(d, left, visited)) return false;
+    if (!visited[right] && !set_symlen(d, right, visited)) return false;
+    int len = d->symlen[left] + d->symlen[right] + 1;
+    if (len > 255) return false;
+    d->symlen[sym] = (uint8_t)len;
+    return true;
+}
+
+/* Reads the Huffman header of one value stream: block geometry, the lowest symbol of every code
+ * length, and the symbol tree. Returns the first byte after it, or NULL if it is malformed. */
+static const uint8_t *set_sizes(const TbFile *f, TbPairs *d, const uint8_t *p) {
+    if (!in_file(f, p, 2)) return NULL;
+    d->flags = *p++;
+    if (d->flags & TB_FLAG_SINGLE_VALUE) {
+        d->min_sym_len = *p++;
+        return p;
+    }
+    if (!in_file(f, p, 9)) return NULL;
+    int groups = 0;
+    while (d->group_len[groups]) groups++;
+    uint64_t tb_size = d->group_idx[groups];
+    if (!tb_size || p[0] > 16 || p[1] > 16) return NULL;
+    d->block_size = 1ULL << p[0];
+    d->span = 1ULL << p[1];
+    d->sparse_size = (tb_size + d->span - 1) / d->span;
+    d->n_blocks = le32(p + 3);
+    d->block_len_size = d->n_blocks + p[2];
+    int max_len = p[7];
+    int min_len = p[8];
+    p += 9;
+    if (min_len < 1 || max_len < min_len || max_len > TB_MAX_SYM_LEN) return NULL;
+    int n_base = max_len - min_len + 1;
+    if (!in_file(f, p, (uint64_t)n_base * 2 + 2)) return NULL;
+    d->min_sym_len = (uint8_t)min_len;
+    d->lowest_sym = p;
+    d->base64[n_base - 1] = 0;
+    for (int i = n_base - 2; i >= 0; --i) {
+        d->base64[i] = (d->base64[i + 1] + le16(p + 2 * i) - le16(p + 2 * i + 2)) / 2;
+    }
+    for (int i = 0; i < n_base; ++i) d->base64[i] <<= 64 - i - min_len;
+    p += n_base * 2;
+
+    d->n_syms = (int)le16(p);
+    p += 2;
+    if (!d->n_syms || d->n_syms >= 0xFFF || !in_file(f, p, (uint64_t)d->n_syms * 3 + 1)) return NULL;
+    d->btree = p;
+    d->symlen = (uint8_t *)calloc((size_t)d->n_syms, 1);
+    uint8_t *visited = (uint8_t *)calloc((size_t)d->n_syms, 1);
+    bool ok = d->symlen && visited;
+    for (int s = 0; ok && s < d->n_syms; ++s) {
+        if (!visited[s]) ok = set_symlen(d, s, visited);
+    }
+    free(visited);
+    return ok ? p + d->n_syms * 3 + (d->n_syms & 1) : NULL;
+}
+
+static const uint8_t *set_dtz_map(TbFile *f, const uint8_t *p, int files) {
+    f->map = p;
+    for (int fl = 0; fl < files; ++fl) {
+        TbPairs *d = &f->pairs[fl][0];
+        if (!(d->flags & TB_FLAG_MAPPED)) continue;
+        if (d->flags & TB_FLAG_WIDE) {
+            p += (p - f->data) & 1;
+            for (int i = 0; i < 4; ++i) {
+                if (!in_file(f, p, 2)) return NULL;
+                d->map_idx[i] = (uint16_t)((p - f->map) / 2 + 1);
+                p += 2 * le16(p) + 2;
+            }
+        } else {
+            for (int i = 0; i < 4; ++i) {
+                if (!in_file(f, p, 1)) return NULL;
+                d->map_idx[i] = (uint16_t)(p - f->map + 1);
+                p += *p + 1;
+            }
+        }
+    }
+    return p + ((p - f->data) & 1);
+}
+
+/* Lays out a mapped .rtbw/.rtbz: per-file pieces order, then for every (file, side) stream the
+ * Huffman header, DTZ value map, sparse index, block lengths and 64-byte aligned data. */
+static bool init_file(const TbTable *t, TbFile *f, bool dtz) {
+    int sides = !dtz && t->mat_key[0] != t->mat_key[1] ? 2 : 1;
+    int files = t->has_pawns ? 4 : 1;
+    bool pp = t->has_pawns && t->pawn_count[1];
+    const uint8_t *p = f->data + 4;
+    if (((*p & TB_HAS_PAWNS) != 0) != t->has_pawns) return false;
+    p++;
+    for (int fl = 0; fl < files; ++fl) {
+        if (!in_file(f, p, 1u + pp + (unsigned)t->pieces)) return false;
+        int order[2][2] = {{p[0] & 0xF, pp ? p[1] & 0xF : 0xF}, {p[0] >> 4, pp ? p[1] >> 4 : 0xF}};
+        p += 1 + pp;
+        for (int k = 0; k < t->pieces; ++k, ++p) {
+            for (int i = 0; i < sides; ++i) {
+                int code = i ? *p >> 4 : *p & 0xF;
+                if ((code & 7) < 1 || (code & 7) > 6) return false;
+                f->pairs[fl][i].pieces[k] = (uint8_t)code;
+            }
+        }
+        for (int i = 0; i < sides; ++i) {
+            if (order[i][0] == 0xF) return false;
+            set_groups(t, &f->pairs[fl][i], order[i], fl);
+        }
+    }
+    p += (p - f->data) & 1;
+    for (int fl = 0; fl < files; ++fl) {
+        for (int i = 0; i < sides; ++i) {
+            if (!(p = set_sizes(f, &f->pairs[fl][i], p))) return false;
+        }
+    }
+    if (dtz && !(p = set_dtz_map(f, p, files))) return false;
+    for (int fl = 0; fl < files; ++fl) {
+        for (int i = 0; i < sides; ++i) {
+            TbPairs *d = &f->pairs[fl][i];
+            if (!in_file(f, p, d->sparse_size * 6)) return false;
+            d->sparse = p;
+            p += d->sparse_size * 6;
+        }
+    }
+    for (int fl = 0; fl < files; ++fl) {
+        for (int i = 0; i < sides; ++i) {
+            TbPairs *d = &f->pairs[fl][i];
+            if (!in_file(f, p, (uint64_t)d->block_len_size * 2)) return false;
+            d->block_len = p;
+            p += d->block_len_size * 2;
+        }
+    }
+    for (int fl = 0; fl < files; ++fl) {
+        for (int i = 0; i < sides; ++i) {
+            TbPairs *d = &f->pairs[fl][i];
+            p += (64 - ((p - f->data) & 63)) & 63;
+            if (!in_file(f, p, d->block_size * d->n_blocks)) return false;
+            d->data = p;
+            p += d->block_size * d->n_blocks;
+        }
+    }
+    return true;
+}
+
+static int decompress_pairs(const TbPairs *d, const uint8_t *end, uint64_t idx) {
+    if (d->flags & TB_FLAG_SINGLE_VALUE) return d->min_sym_len;
+
+    /* The sparse entry k points at value k * span + span / 2; walk the block lengths from there. */
+    uint64_t k = idx / d->span;
+    if (k >= d->sparse_size) return -1;
+    uint32_t block = le32(d->sparse + 6 * k);
+    int offset = (int)le16(d->sparse + 6 * k + 4) + (int)(idx % d->span) - (int)(d->span / 2);
+    while (offset < 0) {
+        if (block == 0) return -1;
+        offset += (int)le16(d->block_len + 2 * --block) + 1;
+    }
+    while (block < d->block_len_size && offset > (int)le16(d->block_len + 2 * block)) {
+        offset -= (int)le16(d->block_len + 2 * block++) + 1;
+    }
+    if (block >= d->n_blocks) return -1;
+
+    const uint8_t *ptr = d->data + block * d->block_size;
+    uint64_t buf = (uint64_t)be32(ptr, end) << 32 | be32(ptr + 4, end);
+    ptr += 8;
+    int bits = 64;
+    int sym;
+    for (;;) {
+        int len = 0;
+        while (buf < d->base64[len]) ++len;
+        sym = (int)((buf - d->base64[len]) >> (64 - len - d->min_sym_len));
+        sym += (int)le16(d->lowest_sym + 2 * len);
+        if (sym >= d->n_syms) return -1;
+        if (offset < d->symlen[sym] + 1) break;
+        offset -= d->symlen[sym] + 1;
+        len += d->min_sym_len;
+        buf <<= len;
+        bits -= len;
+        if (bits <= 32) {
+            bits += 32;
+            buf |= (uint64_t)be32(ptr, end) << (64 - bits);
+            ptr += 4;
+        }
+    }
+    while (d->symlen[sym]) {
+        const uint8_t *lr = d->btree + 3 * sym;
+        int left = lr_left(lr);
+        if (offset < d->symlen[left] + 1) {
+            sym = left;
+        } else {
+            offset -= d->symlen[left] + 1;
+            sym = lr_right(lr);
+        }
+    }
+    return lr_left(d->btree + 3 * sym);
+}
+
+/* DTZ tables store moves unless the ply flags say otherwise, optionally through a value map. */
+static int map_score(const TbFile *f, const TbPairs *d, int value, int wdl) {
+    static const int WDL_MAP[] = {1, 3, 0, 2, 0};
+    if (d->flags & TB_FLAG_MAPPED) {
+        int at = d->map_idx[WDL_MAP[wdl + 2]] + value;
+        value = (d->flags & TB_FLAG_WIDE) ? (int)le16(f->map + 2 * at) : f->map[at];
+    }
+    if ((wdl == TB_WIN && !(d->flags & TB_FLAG_WIN_PLIES)) || (wdl == TB_LOSS && !(d->flags & TB_FLAG_LOSS_PLIES)) ||
+        wdl == TB_CURSED_WIN || wdl == TB_BLESSED_LOSS) {
+        value *= 2;
+    }
+    return value + 1;
+}
+
+static void swap_sq(int *sq, uint8_t *pc, int a, int b) {
+    int s = sq[a];
+    sq[a] = sq[b];
+    sq[b] = s;
+    uint8_t c = pc[a];
+    pc[a] = pc[b];
+    pc[b] = c;
+}
+
+/* Maps pos to its index in the table (colors flipped so the stronger side is white, squares
+ * mirrored into the canonical triangle) and reads the stored value. */
+static int probe_table(const Position *pos, bool dtz, int wdl, int *state) {
+    if (pos->mat_key == KVK_KEY) return 0;
+    const TbTable *t = find_table(pos->mat_key);
+    const TbFile *f = t ? (dtz ? &t->dtz : &t->wdl) : NULL;
+    if (!f || !f->data) {
+        *state = PROBE_FAIL;
+        return 0;
+    }
+    bool flip = (t->mat_key[0] == t->mat_key[1] && pos->side == BLACK) || pos->mat_key != t->mat_key[0];
+    int flip_color = flip ? 8 : 0;
+    int flip_sq = flip ? 56 : 0;
+    int stm = flip ^ pos->side;
+
+    int sq[TB_MAX_PIECES];
+    uint8_t pc[TB_MAX_PIECES];
+    int size = 0;
+    int lead = 0;
+    int file = 0;
+    U64 lead_pawns = 0;
+    if (t->has_pawns) {
+        lead_pawns = pos->bb_piece[tb_piece(f->pairs[0][0].pieces[0] ^ flip_color) - 1];
+        for (U64 b = lead_pawns; b; b &= b - 1) {
+            pc[size] = 0;
+            sq[size++] = lsb_index(b) ^ flip_sq;
+        }
+        lead = size;
+        int best = 0;
+        for (int i = 1; i < lead; ++i) {
+            if (MAP_PAWNS[sq[i]] > MAP_PAWNS[sq[best]]) best = i;
+        }
+        swap_sq(sq, pc, 0, best);
+        file = sq_file(sq[0]) < 4 ? sq_file(sq[0]) : 7 - sq_file(sq[0]);
+    }
+    const TbPairs *d = &f->pairs[file][dtz ? 0 : stm];
+    if (dtz && (d->flags & TB_FLAG_STM) != stm && (t->mat_key[0] != t->mat_key[1] || t->has_pawns)) {
+        *state = PROBE_CHANGE_STM;
+        return 0;
+    }
+    for (U64 b = pos->occ & ~lead_pawns; b; b &= b - 1) {
+        int s = lsb_index(b);
+        sq[size] = s ^ flip_sq;
+        pc[size++] = (uint8_t)(tb_code(pos->piece_on[s]) ^ flip_color);
+    }
+    for (int i = lead; i < size - 1; ++i) {
+        for (int j = i + 1; j < size; ++j) {
+            if (d->pieces[i] == pc[j]) {
+                swap_sq(sq, pc, i, j);
+                break;
+            }
+        }
+    }
+    if (sq_file(sq[0]) > 3) {
+        for (int i = 0; i < size; ++i) sq[i] ^= 7;
+    }
+
+    uint64_t idx;
+    if (t->has_pawns) {
+        idx = LEAD_PAWN_IDX[lead][sq[0]];
+        for (int i = 2; i < lead; ++i) {
+            for (int j = i; j > 1 && MAP_PAWNS[sq[j]] < MAP_PAWNS[sq[j - 1]]; --j) swap_sq(sq, pc, j, j - 1);
+        }
+        for (int i = 1; i < lead; ++i) idx += BINOMIAL[i][MAP_PAWNS[sq[i]]];
+    } else {
+        if (sq_rank(sq[0]) > 3) {
+            for (int i = 0; i < size; ++i) sq[i] ^= 56;
+        }
+        for (int i = 0; i < d->group_len[0]; ++i) {
+            if (!off_a1h8(sq[i])) continue;
+            if (off_a1h8(sq[i]) > 0) {
+                for (int j = i; j < size; ++j) sq[j] = ((sq[j] >> 3) | (sq[j] << 3)) & 63;
+            }
+            break;
+        }
+        if (t->unique_pieces) {
+            uint64_t adjust1 = sq[1] > sq[0];
+            uint64_t adjust2 = (uint64_t)(sq[2] > sq[0]) + (sq[2] > sq[1]);
+            if (off_a1h8(sq[0])) {
+                idx = ((uint64_t)MAP_A1D1D4[sq[0]] * 63 + ((uint64_t)sq[1] - adjust1)) * 62 + (uint64_t)sq[2] - adjust2;
+            } else if (off_a1h8(sq[1])) {
+                idx = (6 * 63 + (uint64_t)sq_rank(sq[0]) * 28 + (uint64_t)MAP_B1H1H7[sq[1]]) * 62 + (uint64_t)sq[2] -
+                      adjust2;
+            } else if (off_a1h8(sq[2])) {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + (uint64_t)sq_rank(sq[0]) * 7 * 28 +
+                      ((uint64_t)sq_rank(sq[1]) - adjust1) * 28 + (uint64_t)MAP_B1H1H7[sq[2]];
+            } else {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + (uint64_t)sq_rank(sq[0]) * 7 * 6 +
+                      ((uint64_t)sq_rank(sq[1]) - adjust1) * 6 + ((uint64_t)sq_rank(sq[2]) - adjust2);
+            }
+        } else {
+            idx = (uint64_t)MAP_KK[MAP_A1D1D4[sq[0]]][sq[1]];
+        }
+    }
+
+    idx *= d->group_idx[0];
+    int at = d->group_len[0];
+    bool remaining_pawns = t->has_pawns && t->pawn_count[1];
+    for (int next = 1; d->group_len[next]; ++next) {
+        int len = d->group_len[next];
+        for (int i = at + 1; i < at + len; ++i) {
+            for (int j = i; j > at && sq[j] < sq[j - 1]; --j) swap_sq(sq, pc, j, j - 1);
+        }
+        uint64_t n = 0;
+        for (int i = 0; i < len; ++i) {
+            int adjust = 0;
+            for (int j = 0; j < at; ++j) adjust += sq[at + i] > sq[j];
+            n += BINOMIAL[i + 1][sq[at + i] - adjust - (remaining_pawns ? 8 : 0)];
+        }
+        remaining_pawns = false;
+        idx += n * d->group_idx[next];
+        at += len;
+    }
+
+    int value = decompress_pairs(d, f->end, idx);
+    if (value < 0) {
+        *state = PROBE_FAIL;
+        return 0;
+    }
+    return dtz ? map_score(f, d, value, wdl) : value - 2;
+}
+
+static bool has_legal_move(const Position *pos) {
+    MoveList list;
+    gen_pseudo_legal(pos, &list);
+    for (int i = 0; i < list.n; ++i) {
+        if (move_is_legal(pos, list.m[i])) return true;
+    }
+    return false;
+}
+
+static inline bool is_zeroing(Move mv) {
+    return (M_FLAGS(mv) & FLAG_CAPTURE) || M_PIECE(mv) == WP || M_PIECE(mv) == BP;
+}
+
+/* WDL of pos, resolving captures (and pawn moves when zeroing is set) by search since the
+ * tables assume the best move is not one of them. *state becomes PROBE_ZEROING when such a
+ * move is the best one. */
+static int search_wdl(Position *pos, bool zeroing, int *state) {
+    MoveList list;
+    gen_pseudo_legal(pos, &list);
+    int best = TB_LOSS;
+    int value;
+    int total = 0;
+    int searched = 0;
+    for (int i = 0; i < list.n; ++i) {
+        Move mv = list.m[i];
+        if (!move_is_legal(pos, mv)) continue;
+        total++;
+        if (!(M_FLAGS(mv) & FLAG_CAPTURE) && (!zeroing || !is_zeroing(mv))) continue;
+        searched++;
+        make_move(pos, mv);
+        value = -search_wdl(pos, false, state);
+        undo_move(pos, mv);
+        if (*state == PROBE_FAIL) return TB_DRAW;
+        if (value > best) {
+            best = value;
+            if (value >= TB_WIN) {
+                *state = PROBE_ZEROING;
+                return value;
+            }
+        }
+    }
+    bool no_more_moves = searched && searched == total;
+    if (no_more_moves) {
+        value = best;
+    } else {
+        value = probe_table(pos, false, TB_DRAW, state);
+        if (*state == PROBE_FAIL) return TB_DRAW;
+    }
+    if (best >= value) {
+        *state = best > TB_DRAW || no_more_moves ? PROBE_ZEROING : PROBE_OK;
+        return best;
+    }
+    *state = PROBE_OK;
+    return value;
+}
+
+static int dtz_before_zeroing(int wdl) {
+    switch (wdl) {
+        case TB_WIN: return 1;
+        case TB_CURSED_WIN: return 101;
+        case TB_BLESSED_LOSS: return -101;
+        case TB_LOSS: return -1;
+        default: return 0;
+    }
+}
+
+/* Plies to the next zeroing move with best play, signed like the WDL; 100 is added for
+ * results that the 50-move rule turns into draws. */
+static int probe_dtz(Position *pos, int *state) {
+    *state = PROBE_OK;
+    int wdl = search_wdl(pos, true, state);
+    if (*state == PROBE_FAIL || wdl == TB_DRAW) return 0;
+    if (*state == PROBE_ZEROING) return dtz_before_zeroing(wdl);
+    int dtz = probe_table(pos, true, wdl, state);
+    if (*state == PROBE_FAIL) return 0;
+    if (*state != PROBE_CHANGE_STM) {
+        return (dtz + 100 * (wdl == TB_BLESSED_LOSS || wdl == TB_CURSED_WIN)) * sign_of(wdl);
+    }
+
+    /* The table only stores the other side to move: take the best reply one ply deeper. */
+    int min_dtz = INT_MAX;
+    MoveList list;
+    gen_pseudo_legal(pos, &list);
+    for (int i = 0; i < list.n; ++i) {
+        Move mv = list.m[i];
+        bool zeroing = is_zeroing(mv);
+        if (!make_move(pos, mv)) continue;
+        dtz = zeroing ? -dtz_before_zeroing(search_wdl(pos, false, state)) : -probe_dtz(pos, state);
+        if (dtz == 1 && in_check(pos, pos->side) && !has_legal_move(pos)) min_dtz = 1;
+        if (!zeroing) dtz += sign_of(dtz);
+        if (dtz < min_dtz && sign_of(dtz) == sign_of(wdl)) min_dtz = dtz;
+        undo_move(pos, mv);
+        if (*state == PROBE_FAIL) return 0;
+    }
+    return min_dtz == INT_MAX ? -1 : min_dtz;
+}
+
+static int piece_type(char c) {
+    switch (c) {
+        case 'P': return 0;
+        case 'N': return 1;
+        case 'B': return 2;
+        case 'R': return 3;
+        case 'Q': return 4;
+        case 'K': return 5;
+        default: return -1;
+    }
+}
+
+/* "KRPvKR" names the pieces of the stronger side, then the weaker one. */
+static bool parse_name(const char *name, size_t len, TbTable *t) {
+    int count[2][6] = {{0}};
+    memset(t, 0, sizeof(*t));
+    int side = WHITE;
+    for (size_t i = 0; i < len; ++i) {
+        if (name[i] == 'v' && side == WHITE) {
+            side = BLACK;
+            continue;
+        }
+        int pt = piece_type(name[i]);
+        if (pt < 0) return false;
+        t->mat_key[0] += MAT_KEY((side == WHITE ? WP : BP) + pt);
+        t->mat_key[1] += MAT_KEY((side == WHITE ? BP : WP) + pt);
+        count[side][pt]++;
+        t->pieces++;
+    }
+    if (side != BLACK || t->pieces < 3 || t->pieces > TB_MAX_PIECES) return false;
+    if (count[WHITE][5] != 1 || count[BLACK][5] != 1) return false;
+    for (int c = WHITE; c <= BLACK; ++c) {
+        for (int pt = 0; pt < 5; ++pt) t->unique_pieces |= count[c][pt] == 1;
+    }
+    t->has_pawns = count[WHITE][0] || count[BLACK][0];
+    bool white_leads = !count[BLACK][0] || (count[WHITE][0] && count[BLACK][0] >= count[WHITE][0]);
+    t->pawn_count[0] = count[white_leads ? WHITE : BLACK][0];
+    t->pawn_count[1] = count[white_leads ? BLACK : WHITE][0];
+    return true;
+}
+
+static bool load_file(TbTable *t, TbFile *f, const char *path, bool dtz) {
+    if (!map_file(path, dtz ? DTZ_MAGIC : WDL_MAGIC, f)) return false;
+    if (init_file(t, f, dtz)) return true;
+    fprintf(stderr, "info string tablebase %s is malformed\n", path);
+    unmap_file(f);
+    return false;
+}
+
+static void scan_dir(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) return;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        const char *name = ent->d_name;
+        size_t len = strlen(name);
+        if (len < 6) continue;
+        bool wdl = !strcmp(name + len - 5, ".rtbw");
+        bool dtz = !strcmp(name + len - 5, ".rtbz");
+        TbTable parsed;
+        if ((!wdl && !dtz) || !parse_name(name, len - 5, &parsed)) continue;
+        TbTable *t = find_table(parsed.mat_key[0]);
+        if (!t) {
+            if (N_TABLES >= TB_MAX_TABLES) continue;
+            t = &TABLES[N_TABLES++];
+            *t = parsed;
+            index_insert(t->mat_key[0], t);
+            index_insert(t->mat_key[1], t);
+        }
+        char path[TB_PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", dir, name);
+        TbFile *f = wdl ? &t->wdl : &t->dtz;
+        if (f->data) continue;
+        load_file(t, f, path, dtz);
+        if (t->wdl.data && t->pieces > LARGEST) LARGEST = t->pieces;
+    }
+    closedir(d);
+}
+
+static void free_locked(void) {
+    for (int i = 0; i < N_TABLES; ++i) {
+        unmap_file(&TABLES[i].wdl);
+        unmap_file(&TABLES[i].dtz);
+    }
+    memset(INDEX, 0, sizeof(INDEX));
+    N_TABLES = 0;
+    LARGEST = 0;
+    LOADED_PATHS[0] = '\0';
+}
+
+static int count_loaded(void) {
+    int n = 0;
+    for (int i = 0; i < N_TABLES; ++i) n += TABLES[i].wdl.data != NULL;
+    return n;
+}
+
+/* Tables are process-wide; loading the same path again is a no-op. While any search holds
+ * tb_acquire() the tables cannot be swapped and a different path returns -1. */
+int tb_init(const char *paths) {
+    if (pthread_rwlock_trywrlock(&TB_LOCK) != 0) {
+        pthread_rwlock_rdlock(&TB_LOCK);
+        int n = strcmp(paths, LOADED_PATHS) ? -1 : count_loaded();
+        pthread_rwlock_unlock(&TB_LOCK);
+        return n;
+    }
+    if (!MAPS_READY) init_maps();
+    if (strcmp(paths, LOADED_PATHS) != 0) {
+        free_locked();
+        char buf[TB_PATH_MAX];
+        snprintf(buf, sizeof(buf), "%s", paths);
+        snprintf(LOADED_PATHS, sizeof(LOADED_PATHS), "%s", paths);
+        char *save = NULL;
+        for (char *dir = strtok_r(buf, ":", &save); dir; dir = strtok_r(NULL, ":", &save)) scan_dir(dir);
+    }
+    int n = count_loaded();
+    pthread_rwlock_unlock(&TB_LOCK);
+    return n;
+}
+
+void tb_free(void) {
+    pthread_rwlock_wrlock(&TB_LOCK);
+    free_locked();
+    pthread_rwlock_unlock(&TB_LOCK);
+}
+
+void tb_acquire(void) {
+    pthread_rwlock_rdlock(&TB_LOCK);
+}
+
+void tb_release(void) {
+    pthread_rwlock_unlock(&TB_LOCK);
+}
+
+int tb_largest(void) {
+    return LARGEST;
+}
+
+static bool probe_allowed(const Position *pos) {
+    if (pos->castle_rights || popcount64(pos->occ) > LARGEST) return false;
+    return pos->mat_key == KVK_KEY || find_table(pos->mat_key);
+}
+
+bool tb_probe_wdl(Position *pos, int *wdl) {
+    if (!probe_allowed(pos)) return false;
+    int state = PROBE_OK;
+    int value = search_wdl(pos, false, &state);
+    if (state == PROBE_FAIL) return false;
+    *wdl = value;
+    return true;
+}
+
+bool tb_probe_dtz(Position *pos, int *dtz) {
+    if (!probe_allowed(pos)) return false;
+    int state = PROBE_OK;
+    int value = probe_dtz(pos, &state);
+    if (state == PROBE_FAIL) return false;
+    *dtz = value;
+    return true;
+}
+
+/* True when a position since the last zeroing move, the root included, has already occurred before. */
+static bool has_repeated(const Position *pos) {
+    int stop = pos->ply - pos->halfmove_clock;
+    for (int j = pos->ply; j - 4 >= 0 && j - 4 >= stop; --j) {
+        uint64_t key = j == pos->ply ? pos->key : pos->st[j].key;
+        for (int i = j - 4; i >= 0 && i >= stop; i -= 2) {
+            if (pos->st[i].key == key) return true;
+        }
+    }
+    return false;
+}
+
+/* A root move into a threefold repetition or past the fifty-move limit draws whatever the tables say. */
+static bool draw_by_rule(const Position *pos) {
+    if (pos_repetitions(pos) >= 2) return true;
+    return pos->halfmove_clock >= 100 && (!in_check(pos, pos->side) || has_legal_move(pos));
+}
+
+/* Ranks a root move by the DTZ after it. Every win inside the fifty-move budget ranks the same, so
+ * the search picks among them, unless the game has already repeated, where quicker wins rank higher.
+ * Wins the fifty-move rule spoils rank between the safe wins and the draws; losses rank slowest first. */
+static int root_rank(int dtz, int cnt50, bool repeated) {
+    if (dtz > 0) {
+        if (dtz + cnt50 > 99) return TB_MAX_DTZ / 2 - (dtz + cnt50);
+        return repeated ? TB_MAX_DTZ - dtz : TB_MAX_DTZ;
+    }
+    if (dtz < 0) return -dtz + cnt50 <= 100 ? -TB_MAX_DTZ - dtz : -TB_MAX_DTZ / 2 + (-dtz + cnt50);
+    return 0;
+}
+
+/* Keeps the root moves with the best rank: all moves that hold the draw, every safe win, or the
+ * slowest losses. Returns 0 when any move cannot be probed, leaving the root unfiltered. */
+int tb_root_moves(Position *pos, Move *moves, int *wdl) {
+    if (!probe_allowed(pos)) return 0;
+    int cnt50 = pos->halfmove_clock;
+    bool repeated = has_repeated(pos);
+    MoveList list;
+    gen_pseudo_legal(pos, &list);
+    int rank[MAX_MOVES];
+    int n = 0;
+    int best = INT_MIN;
+    for (int i = 0; i < list.n; ++i) {
+        Move mv = list.m[i];
+        if (!make_move(pos, mv)) continue;
+        int state = PROBE_OK;
+        int dtz;
+        if (pos->halfmove_clock == 0) {
+            dtz = dtz_before_zeroing(-search_wdl(pos, false, &state));
+        } else if (draw_by_rule(pos)) {
+            dtz = 0;
+        } else {
+            dtz = -probe_dtz(pos, &state);
+            dtz += sign_of(dtz);
+        }
+        if (dtz == 2 && in_check(pos, pos->side) && !has_legal_move(pos)) dtz = 1;
+        undo_move(pos, mv);
+        if (state == PROBE_FAIL) return 0;
+        moves[n] = mv;
+        rank[n] = root_rank(dtz, cnt50, repeated);
+        if (rank[n] > best) best = rank[n];
+        n++;
+    }
+    int kept = 0;
+    for (int i = 0; i < n; ++i) {
+        if (rank[i] == best) moves[kept++] = moves[i];
+    }
+    *wdl = best > TB_MAX_DTZ / 2 ? TB_WIN : best > 0 ? TB_CURSED_WIN : best == 0 ? TB_DRAW
+         : best >= -TB_MAX_DTZ / 2 ? TB_BLESSED_LOSS : TB_LOSS;
+    return kept;
+}
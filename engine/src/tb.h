@@ -0,0 +1,20 @@
+#pragma once
+#include <stdbool.h>
+#include "position.h"
+#include "movegen.h"
+
+#define TB_MAX_PIECES 7
+#define TB_MAX_TABLES 512
+
+enum { TB_LOSS = -2, TB_BLESSED_LOSS = -1, TB_DRAW = 0, TB_CURSED_WIN = 1, TB_WIN = 2 };
+
+/* Returns the number of WDL tables loaded, or -1 when a search holds the tables and paths
+ * differs from the loaded set. Probes must run between tb_acquire() and tb_release(). */
+int tb_init(const char *paths);
+void tb_free(void);
+void tb_acquire(void);
+void tb_release(void);
+int tb_largest(void);
+bool tb_probe_wdl(Position *pos, int *wdl);
+bool tb_probe_dtz(Position *pos, int *dtz);
+int tb_root_moves(Position *pos, Move *moves, int *wdl);
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tbsuite.h"
+#include "bitbase.h"
+#include "tables.h"
+#include "tb.h"
+
+#define TB_SUITE_MAX_MOVES 8
+#define TB_SUITE_UNSET (-1000)
+
+typedef struct {
+    char fen[256];
+    int wdl;
+    int dtz;
+    int n_bm;
+    char bm[TB_SUITE_MAX_MOVES][8];
+    int n_moves;
+    char moves[TB_SUITE_MAX_MOVES][8];
+} TbEntry;
+
+static int parse_moves(const char *q, char (*out)[8]) {
+    int n = 0;
+    int used = 0;
+    while (n < TB_SUITE_MAX_MOVES && sscanf(q, "%7[a-h1-8qrbn]%n", out[n], &used) == 1) {
+        n++;
+        q += used;
+        while (*q == ' ') ++q;
+    }
+    return n;
+}
+
+static bool parse_epd_line(const char *line, TbEntry *e) {
+    memset(e, 0, sizeof(*e));
+    e->wdl = e->dtz = TB_SUITE_UNSET;
+    const char *semi = strchr(line, ';');
+    if (!semi) return false;
+    size_t len = (size_t)(semi - line);
+    while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t')) --len;
+    if (len == 0 || len >= sizeof(e->fen)) return false;
+    memcpy(e->fen, line, len);
+    e->fen[len] = '\0';
+
+    const char *p = semi;
+    while ((p = strchr(p, ';')) != NULL) {
+        ++p;
+        while (*p == ' ') ++p;
+        if (!strncmp(p, "wdl ", 4)) {
+            e->wdl = atoi(p + 4);
+        } else if (!strncmp(p, "dtz ", 4)) {
+            e->dtz = atoi(p + 4);
+        } else if (!strncmp(p, "bm ", 3)) {
+            e->n_bm = parse_moves(p + 3, e->bm);
+        } else if (!strncmp(p, "moves ", 6)) {
+            e->n_moves = parse_moves(p + 6, e->moves);
+        }
+    }
+    return true;
+}
+
+static void fen_of(char *out, size_t size, const int *sq, const char *pieces, int n, int side) {
+    char board[64];
+    memset(board, 0, sizeof(board));
+    for (int i = 0; i < n; ++i) board[sq[i]] = pieces[i];
+    size_t len = 0;
+    for (int rank = 7; rank >= 0; --rank) {
+        int empty = 0;
+        for (int file = 0; file < 8; ++file) {
+            char c = board[rank * 8 + file];
+            if (!c) {
+                empty++;
+                continue;
+            }
+            if (empty) out[len++] = (char)('0' + empty);
+            empty = 0;
+            out[len++] = c;
+        }
+        if (empty) out[len++] = (char)('0' + empty);
+        if (rank) out[len++] = '/';
+    }
+    snprintf(out + len, size - len, " %c - - 0 1", side == WHITE ? 'w' : 'b');
+}
+
+/* Probes every legal KPvK position, and its color-flipped twin, against the KPK bitbase. */
+static int kpk_mismatches(Position *pos, int *checked) {
+    int bad = 0;
+    char fen[128];
+    *checked = 0;
+    tb_acquire();
+    for (int wk = 0; wk < 64; ++wk) {
+        for (int wp = 8; wp < 56; ++wp) {
+            for (int bk = 0; bk < 64; ++bk) {
+                if (wk == wp || wk == bk || wp == bk || (KING_ATTACKS[wk] & (1ULL << bk))) continue;
+                for (int stm = WHITE; stm <= BLACK; ++stm) {
+                    if (stm == WHITE && (PAWN_ATTACKS[WHITE][wp] & (1ULL << bk))) continue;
+                    int expected = kpk_probe(wk, wp, bk, stm) ? (stm == WHITE ? TB_WIN : TB_LOSS) : TB_DRAW;
+                    for (int flip = 0; flip < 2; ++flip) {
+                        int sq[3] = {wk, wp, bk};
+                        if (flip) {
+                            sq[0] = bk ^ 56;
+                            sq[1] = wp ^ 56;
+                            sq[2] = wk ^ 56;
+                        }
+                        fen_of(fen, sizeof(fen), sq, flip ? "Kpk" : "KPk", 3, stm ^ flip);
+                        int wdl = TB_SUITE_UNSET;
+                        if (!pos_from_fen(pos, fen) || !tb_probe_wdl(pos, &wdl) || wdl != expected) {
+                            if (bad < 5) printf("    kpk: %s expected %d got %d\n", fen, expected, wdl);
+                            bad++;
+                        }
+                        (*checked)++;
+                    }
+                }
+            }
+        }
+    }
+    tb_release();
+    return bad;
+}
+
+/* Loads the tables in tb_dir, cross-checks KPvK against the bitbase, then checks each EPD line:
+ * the wdl and dtz probes, and bm against a depth-1 search restricted by the root filter. The
+ * search runs after playing any listed moves from the FEN, so a line can give the game a history. */
+int tb_suite_run(ChessEngine *eng, const char *tb_dir, const char *epd_path) {
+    FILE *f = fopen(epd_path, "r");
+    if (!f) {
+        printf("tbsuite: cannot open %s\n", epd_path);
+        return -1;
+    }
+    if (!chess_set_option(eng, "SyzygyPath", tb_dir)) {
+        printf("tbsuite: no tablebases in %s\n", tb_dir);
+        fclose(f);
+        return -1;
+    }
+    Position *pos = (Position *)malloc(sizeof(Position));
+    if (!pos) {
+        fclose(f);
+        return -1;
+    }
+
+    int checked = 0;
+    int failures = kpk_mismatches(pos, &checked);
+    printf("kpk: %d positions, %d disagree with the bitbase\n", checked, failures);
+    printf("%3s %4s %4s %6s  %-6s %s\n", "#", "wdl", "dtz", "move", "result", "fen");
+    char line[1024];
+    int index = 0;
+    while (fgets(line, sizeof(line), f)) {
+        TbEntry e;
+        if (line[0] == '#' || !parse_epd_line(line, &e)) continue;
+        ++index;
+        const char *moves[TB_SUITE_MAX_MOVES];
+        for (int i = 0; i < e.n_moves; ++i) moves[i] = e.moves[i];
+        if (!pos_from_fen(pos, e.fen) || !chess_set_position(eng, e.fen, moves, e.n_moves)) {
+            printf("%3d %4s %4s %6s  %-6s %s\n", index, "-", "-", "-", "BADFEN", e.fen);
+            failures++;
+            continue;
+        }
+        int wdl = TB_SUITE_UNSET;
+        int dtz = TB_SUITE_UNSET;
+        tb_acquire();
+        bool ok = tb_probe_wdl(pos, &wdl) && tb_probe_dtz(pos, &dtz);
+        tb_release();
+        ok = ok && (e.wdl == TB_SUITE_UNSET || wdl == e.wdl) && (e.dtz == TB_SUITE_UNSET || dtz == e.dtz);
+        char move[8] = "-";
+        if (e.n_bm) {
+            ChessLimits lim;
+            memset(&lim, 0, sizeof(lim));
+            lim.depth = 1;
+            ChessInfo info;
+            bool found = chess_search(eng, &lim, NULL, NULL, &info) && info.tbhits > 0;
+            snprintf(move, sizeof(move), "%s", info.bestmove);
+            bool listed = false;
+            for (int i = 0; i < e.n_bm; ++i) listed |= !strcmp(info.bestmove, e.bm[i]);
+            ok = ok && found && listed;
+        }
+        if (!ok) failures++;
+        printf("%3d %4d %4d %6s  %-6s %s\n", index, wdl, dtz, move, ok ? "ok" : "FAIL", e.fen);
+    }
+    fclose(f);
+    free(pos);
+    printf("failures %d\n", failures);
+    fflush(stdout);
+    return failures;
+}
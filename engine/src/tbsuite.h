@@ -0,0 +1,4 @@
+#pragma once
+#include "chessv2.h"
+
+int tb_suite_run(ChessEngine *eng, const char *tb_dir, const char *epd_path);
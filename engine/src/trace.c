@@ -0,0 +1,33 @@
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+_Static_assert(sizeof(TraceRecord) == 32, "trace record layout changed");
+
+bool trace_open(TraceWriter *tw, const char *path) {
+    memset(tw, 0, sizeof(*tw));
+    tw->buf = (TraceRecord *)malloc(TRACE_BUFFER_RECORDS * sizeof(TraceRecord));
+    tw->f = fopen(path, "wb");
+    if (!tw->buf || !tw->f) {
+        trace_close(tw);
+        return false;
+    }
+    TraceHeader h = {TRACE_MAGIC, TRACE_VERSION, (uint16_t)sizeof(TraceRecord)};
+    fwrite(&h, sizeof(h), 1, tw->f);
+    return true;
+}
+
+void trace_flush(TraceWriter *tw) {
+    if (tw->f && tw->n > 0) {
+        tw->written += fwrite(tw->buf, sizeof(TraceRecord), (size_t)tw->n, tw->f);
+        fflush(tw->f);
+    }
+    tw->n = 0;
+}
+
+void trace_close(TraceWriter *tw) {
+    trace_flush(tw);
+    if (tw->f) fclose(tw->f);
+    free(tw->buf);
+    memset(tw, 0, sizeof(*tw));
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TRACE_MAGIC 0x54325643u
+#define TRACE_VERSION 1
+#define TRACE_BUFFER_RECORDS 8192
+
+enum {
+    TRACE_QSEARCH = 1 << 0,
+    TRACE_TT_HIT = 1 << 1,
+    TRACE_TT_CUT = 1 << 2,
+    TRACE_BETA_CUT = 1 << 3,
+    TRACE_IN_CHECK = 1 << 4
+};
+
+typedef enum {
+    PRUNE_NONE = 0,
+    PRUNE_TT,
+    PRUNE_MATE_DISTANCE,
+    PRUNE_STAND_PAT,
+    PRUNE_MAX_PLY,
+    PRUNE_STOPPED,
+    PRUNE_NO_MOVES,
+    PRUNE_ENDGAME,
+    PRUNE_TABLEBASE,
+    PRUNE_FUTILITY,
+    PRUNE_COUNT
+} TracePrune;
+
+typedef struct {
+    uint64_t key;
+    uint32_t move;
+    uint32_t best;
+    int16_t alpha;
+    int16_t beta;
+    int16_t score;
+    uint16_t search_id;
+    uint8_t ply;
+    int8_t depth;
+    uint8_t root_depth;
+    uint8_t flags;
+    uint8_t prune;
+    uint8_t reserved[3];
+} TraceRecord;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+} TraceHeader;
+
+typedef struct {
+    FILE *f;
+    TraceRecord *buf;
+    int n;
+    uint16_t search_id;
+    uint64_t written;
+} TraceWriter;
+
+bool trace_open(TraceWriter *tw, const char *path);
+void trace_close(TraceWriter *tw);
+void trace_flush(TraceWriter *tw);
+
+static inline void trace_emit(TraceWriter *tw, const TraceRecord *rec) {
+    tw->buf[tw->n++] = *rec;
+    if (tw->n == TRACE_BUFFER_RECORDS) trace_flush(tw);
+}
+
+static inline int16_t trace_clamp(int v) {
+    return (int16_t)(v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v);
+}
@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "tt.h"
+#include "stats.h"
 
 void tt_init(TT *tt, size_t mb) {
     if (mb < 1) mb = 1;
@@ -12,6 +13,7 @@ void tt_init(TT *tt, size_t mb) {
     tt->t = (TTEntry *)calloc(n, sizeof(TTEntry));
     tt->n = n;
     tt->mask = (uint64_t)(n - 1);
+    tt->gen = 0;
 }
 
 void tt_free(TT *tt) {
@@ -21,19 +23,46 @@ void tt_free(TT *tt) {
     tt->mask = 0;
 }
 
+void tt_clear(TT *tt) {
+    if (tt->t) memset(tt->t, 0, tt->n * sizeof(TTEntry));
+    tt->gen = 0;
+}
+
+void tt_new_search(TT *tt) {
+    tt->gen++;
+}
+
 TTEntry *tt_probe(TT *tt, uint64_t key) {
     if (!tt->t) return NULL;
-    return &tt->t[key & tt->mask];
+    TTEntry *e = &tt->t[key & tt->mask];
+    STAT_INC(tt_probes);
+#ifdef STATS
+    if (e->key16 == tt_key16(key) && e->flag != TT_EMPTY) STAT_INC(tt_hits);
+#endif
+    return e;
 }
 
-void tt_store(TT *tt, uint64_t key, int depth, int score, TTFlag flag, Move best) {
+/* eval is the static eval of the position, or TT_EVAL_NONE to keep the one already stored. */
+void tt_store(TT *tt, uint64_t key, int depth, int score, TTFlag flag, Move best, int eval) {
     if (!tt->t) return;
     TTEntry *e = &tt->t[key & tt->mask];
-    if (e->depth > depth && e->key16 == (uint16_t)key) return;
-    e->key16 = (uint16_t)key;
+    if (e->key16 == tt_key16(key)) {
+        if (eval == TT_EVAL_NONE && e->flag != TT_EMPTY) eval = e->eval;
+        if (e->depth > depth) {
+            e->eval = (int16_t)eval;
+            return;
+        }
+        if (!best) best = e->move32;
+    } else if (e->gen == tt->gen && e->depth > depth + 2) {
+        return;
+    }
+    STAT_INC(tt_stores);
+    e->key16 = tt_key16(key);
     e->depth = (uint8_t)depth;
     e->flag = (uint8_t)flag;
     e->score = (int16_t)score;
     e->move16 = (uint16_t)(best & 0xFFFFu);
+    e->gen = tt->gen;
+    e->eval = (int16_t)eval;
     e->move32 = best;
 }
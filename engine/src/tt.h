@@ -4,13 +4,16 @@
 
 typedef enum { TT_EMPTY = 0, TT_EXACT = 1, TT_LOWER = 2, TT_UPPER = 3 } TTFlag;
 
+#define TT_EVAL_NONE INT16_MIN
+
 typedef struct {
     uint16_t key16;
     uint8_t depth;
     uint8_t flag;
     int16_t score;
     uint16_t move16;
-    uint16_t pad;
+    uint16_t gen;
+    int16_t eval;
     uint32_t move32;
 } TTEntry;
 
@@ -18,9 +21,16 @@ typedef struct {
     TTEntry *t;
     size_t n;
     uint64_t mask;
+    uint16_t gen;
 } TT;
 
+static inline uint16_t tt_key16(uint64_t key) {
+    return (uint16_t)(key >> 48);
+}
+
 void tt_init(TT *tt, size_t mb);
 void tt_free(TT *tt);
+void tt_clear(TT *tt);
+void tt_new_search(TT *tt);
 TTEntry *tt_probe(TT *tt, uint64_t key);
-void tt_store(TT *tt, uint64_t key, int depth, int score, TTFlag flag, Move best);
+void tt_store(TT *tt, uint64_t key, int depth, int score, TTFlag flag, Move best, int eval);
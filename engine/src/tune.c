@@ -0,0 +1,469 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <pthread.h>
+#include "tune.h"
+#include "eval.h"
+#include "endgame.h"
+#include "packed.h"
+#include "movegen.h"
+#include "make.h"
+#include "init.h"
+#include "search.h"
+#include "time.h"
+
+#define TUNE_MAX_THREADS 256
+#define TUNE_QS_PLY 16
+#define ADAM_BETA1 0.9
+#define ADAM_BETA2 0.999
+#define ADAM_EPS 1e-8
+
+typedef struct {
+    PackedPos *raw;
+    size_t n_raw;
+    size_t cap_raw;
+
+    uint64_t *offset;
+    uint16_t *index;
+    int8_t *coef;
+    float *result;
+    size_t n;
+    size_t n_features;
+} Dataset;
+
+typedef struct {
+    const Dataset *ds;
+    size_t begin;
+    size_t end;
+    uint16_t *index;
+    int8_t *coef;
+    uint64_t *offset;
+    float *result;
+    size_t n;
+    size_t n_features;
+    size_t cap;
+    uint64_t mismatches;
+    const int *weights;
+} ResolveJob;
+
+typedef struct {
+    const Dataset *ds;
+    size_t begin;
+    size_t end;
+    const double *w;
+    double k;
+    double *grad;
+    double error;
+} GradJob;
+
+static bool push_raw(Dataset *ds, const Position *pos, int result) {
+    if (ds->n_raw == ds->cap_raw) {
+        size_t cap = ds->cap_raw ? ds->cap_raw * 2 : 1u << 16;
+        PackedPos *raw = (PackedPos *)realloc(ds->raw, cap * sizeof(PackedPos));
+        if (!raw) return false;
+        ds->raw = raw;
+        ds->cap_raw = cap;
+    }
+    pack_position(pos, 0, result, &ds->raw[ds->n_raw++]);
+    return true;
+}
+
+static bool parse_result(const char *line, int *result) {
+    if (strstr(line, "1/2-1/2") || strstr(line, "[0.5]")) *result = 0;
+    else if (strstr(line, "1-0") || strstr(line, "[1.0]") || strstr(line, "[1]")) *result = 1;
+    else if (strstr(line, "0-1") || strstr(line, "[0.0]") || strstr(line, "[0]")) *result = -1;
+    else return false;
+    return true;
+}
+
+static bool parse_fen_prefix(const char *line, char *fen, size_t cap) {
+    size_t used = 0;
+    int fields = 0;
+    const char *p = line;
+    while (fields < 6) {
+        while (*p == ' ' || *p == '\t') ++p;
+        const char *start = p;
+        while (*p && !isspace((unsigned char)*p) && *p != ';' && *p != '[' && *p != '"') ++p;
+        size_t len = (size_t)(p - start);
+        if (len == 0) break;
+        bool digits = true;
+        for (size_t i = 0; i < len; ++i) digits = digits && isdigit((unsigned char)start[i]);
+        if (fields >= 4 && !digits) break;
+        if (used + len + 2 > cap) return false;
+        if (fields) fen[used++] = ' ';
+        memcpy(fen + used, start, len);
+        used += len;
+        fields++;
+    }
+    fen[used] = '\0';
+    return fields >= 4;
+}
+
+static bool load_dataset(Dataset *ds, const char *path, uint64_t limit) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    size_t len = strlen(path);
+    Position *pos = (Position *)malloc(sizeof(Position));
+    if (!pos) {
+        fclose(f);
+        return false;
+    }
+    if (len > 4 && !strcmp(path + len - 4, ".bin")) {
+        PackedPos rec;
+        while ((!limit || ds->n_raw < limit) && fread(&rec, sizeof(rec), 1, f) == 1) {
+            int result = 0;
+            if (unpack_position(&rec, pos, NULL, &result) && !push_raw(ds, pos, result)) break;
+        }
+    } else {
+        char line[1024];
+        char fen[128];
+        while ((!limit || ds->n_raw < limit) && fgets(line, sizeof(line), f)) {
+            int result = 0;
+            if (line[0] == '#' || !parse_result(line, &result)) continue;
+            if (!parse_fen_prefix(line, fen, sizeof(fen)) || !pos_from_fen(pos, fen)) continue;
+            if (pos->king_sq[WHITE] < 0 || pos->king_sq[BLACK] < 0) continue;
+            if (!push_raw(ds, pos, result)) break;
+        }
+    }
+    free(pos);
+    fclose(f);
+    return ds->n_raw > 0;
+}
+
+static int capture_value(Move mv) {
+    static const int val[13] = {0, 1, 3, 3, 5, 9, 0, 1, 3, 3, 5, 9, 0};
+    Piece cap = M_CAP(mv);
+    return val[cap == EMPTY ? WP : cap] * 16 - val[M_PIECE(mv)];
+}
+
+static int resolve_qs(Position *pos, int alpha, int beta, int ply, Move *pv, int *pv_len) {
+    *pv_len = 0;
+    int stand = eval(pos);
+    if (stand >= beta || ply >= TUNE_QS_PLY) return stand;
+    if (stand > alpha) alpha = stand;
+
+    MoveList list;
+    gen_pseudo_legal(pos, &list);
+    int scores[MAX_MOVES];
+    int n = 0;
+    for (int i = 0; i < list.n; ++i) {
+        if (!(M_FLAGS(list.m[i]) & FLAG_CAPTURE)) continue;
+        list.m[n] = list.m[i];
+        scores[n++] = capture_value(list.m[i]);
+    }
+    for (int i = 0; i < n; ++i) {
+        int best = i;
+        for (int j = i + 1; j < n; ++j) {
+            if (scores[j] > scores[best]) best = j;
+        }
+        Move mv = list.m[best];
+        list.m[best] = list.m[i];
+        scores[best] = scores[i];
+        if (!make_move(pos, mv)) continue;
+        Move child[TUNE_QS_PLY];
+        int child_len = 0;
+        int score = -resolve_qs(pos, -beta, -alpha, ply + 1, child, &child_len);
+        undo_move(pos, mv);
+        if (score > alpha) {
+            alpha = score;
+            pv[0] = mv;
+            memcpy(pv + 1, child, (size_t)child_len * sizeof(Move));
+            *pv_len = child_len + 1;
+            if (alpha >= beta) break;
+        }
+    }
+    return alpha;
+}
+
+static bool job_reserve(ResolveJob *job, size_t extra) {
+    if (job->n_features + extra <= job->cap) return true;
+    size_t cap = job->cap ? job->cap * 2 : 1u << 16;
+    while (cap < job->n_features + extra) cap *= 2;
+    uint16_t *index = (uint16_t *)realloc(job->index, cap * sizeof(uint16_t));
+    if (index) job->index = index;
+    int8_t *coef = (int8_t *)realloc(job->coef, cap * sizeof(int8_t));
+    if (coef) job->coef = coef;
+    if (!index || !coef) return false;
+    job->cap = cap;
+    return true;
+}
+
+static void *resolve_worker(void *arg) {
+    ResolveJob *job = (ResolveJob *)arg;
+    size_t count = job->end - job->begin;
+    job->offset = (uint64_t *)malloc((count + 1) * sizeof(uint64_t));
+    job->result = (float *)malloc(count * sizeof(float));
+    Position *pos = (Position *)malloc(sizeof(Position));
+    if (!job->offset || !job->result || !pos) {
+        free(pos);
+        return NULL;
+    }
+    job->offset[0] = 0;
+    for (size_t i = job->begin; i < job->end; ++i) {
+        int result = 0;
+        if (!unpack_position(&job->ds->raw[i], pos, NULL, &result)) continue;
+        if (in_check(pos, pos->side)) continue;
+        Move pv[TUNE_QS_PLY];
+        int pv_len = 0;
+        resolve_qs(pos, -INF, INF, 0, pv, &pv_len);
+        for (int k = 0; k < pv_len; ++k) make_move(pos, pv[k]);
+        int eg_score = 0;
+        if (endgame_eval(pos, &eg_score) != ENDGAME_NONE) continue;
+        if (!job_reserve(job, EVAL_MAX_FEATURES)) break;
+        uint16_t *index = job->index + job->n_features;
+        int8_t *coef = job->coef + job->n_features;
+        int nf = eval_features(pos, index, coef);
+        int dot = 0;
+        for (int k = 0; k < nf; ++k) dot += job->weights[index[k]] * coef[k];
+        int expect = eval(pos);
+        if (pos->side == BLACK) expect = -expect;
+        if (dot != expect) job->mismatches++;
+        job->n_features += (size_t)nf;
+        job->result[job->n] = (float)(result + 1) * 0.5f;
+        job->offset[++job->n] = job->n_features;
+    }
+    free(pos);
+    return NULL;
+}
+
+static bool resolve_dataset(Dataset *ds, int threads) {
+    int weights[EVAL_N_FEATURES];
+    eval_get_weights(weights);
+    ResolveJob *jobs = (ResolveJob *)calloc((size_t)threads, sizeof(ResolveJob));
+    pthread_t tids[TUNE_MAX_THREADS];
+    if (!jobs) return false;
+    size_t chunk = (ds->n_raw + (size_t)threads - 1) / (size_t)threads;
+    for (int t = 0; t < threads; ++t) {
+        jobs[t].ds = ds;
+        jobs[t].weights = weights;
+        jobs[t].begin = (size_t)t * chunk < ds->n_raw ? (size_t)t * chunk : ds->n_raw;
+        jobs[t].end = jobs[t].begin + chunk < ds->n_raw ? jobs[t].begin + chunk : ds->n_raw;
+    }
+    int started = 0;
+    for (int t = 0; t < threads; ++t) {
+        if (pthread_create(&tids[t], NULL, resolve_worker, &jobs[t]) != 0) break;
+        started++;
+    }
+    for (int t = started; t < threads; ++t) resolve_worker(&jobs[t]);
+    for (int t = 0; t < started; ++t) pthread_join(tids[t], NULL);
+
+    size_t n = 0;
+    size_t nf = 0;
+    uint64_t mismatches = 0;
+    for (int t = 0; t < threads; ++t) {
+        n += jobs[t].n;
+        nf += jobs[t].n_features;
+        mismatches += jobs[t].mismatches;
+    }
+    ds->offset = (uint64_t *)malloc((n + 1) * sizeof(uint64_t));
+    ds->result = (float *)malloc((n ? n : 1) * sizeof(float));
+    ds->index = (uint16_t *)malloc((nf ? nf : 1) * sizeof(uint16_t));
+    ds->coef = (int8_t *)malloc((nf ? nf : 1) * sizeof(int8_t));
+    bool ok = ds->offset && ds->result && ds->index && ds->coef;
+    if (ok) {
+        ds->offset[0] = 0;
+        for (int t = 0; t < threads; ++t) {
+            ResolveJob *job = &jobs[t];
+            for (size_t i = 0; i < job->n; ++i) {
+                ds->result[ds->n + i] = job->result[i];
+                ds->offset[ds->n + i + 1] = ds->n_features + job->offset[i + 1];
+            }
+            if (job->n_features) {
+                memcpy(ds->index + ds->n_features, job->index, job->n_features * sizeof(uint16_t));
+                memcpy(ds->coef + ds->n_features, job->coef, job->n_features * sizeof(int8_t));
+            }
+            ds->n += job->n;
+            ds->n_features += job->n_features;
+        }
+    }
+    for (int t = 0; t < threads; ++t) {
+        free(jobs[t].index);
+        free(jobs[t].coef);
+        free(jobs[t].offset);
+        free(jobs[t].result);
+    }
+    free(jobs);
+    free(ds->raw);
+    ds->raw = NULL;
+    ds->n_raw = 0;
+    if (mismatches) fprintf(stderr, "tune: %llu feature/eval mismatches\n", (unsigned long long)mismatches);
+    return ok && mismatches == 0;
+}
+
+static inline double sigmoid(double k, double e) {
+    return 1.0 / (1.0 + pow(10.0, -k * e / 400.0));
+}
+
+static void *grad_worker(void *arg) {
+    GradJob *job = (GradJob *)arg;
+    const Dataset *ds = job->ds;
+    double error = 0.0;
+    for (size_t i = job->begin; i < job->end; ++i) {
+        uint64_t lo = ds->offset[i];
+        uint64_t hi = ds->offset[i + 1];
+        double e = 0.0;
+        for (uint64_t j = lo; j < hi; ++j) e += job->w[ds->index[j]] * (double)ds->coef[j];
+        double s = sigmoid(job->k, e);
+        double diff = s - (double)ds->result[i];
+        error += diff * diff;
+        if (!job->grad) continue;
+        double g = diff * s * (1.0 - s);
+        for (uint64_t j = lo; j < hi; ++j) job->grad[ds->index[j]] += g * (double)ds->coef[j];
+    }
+    job->error = error;
+    return NULL;
+}
+
+static double run_epoch(const Dataset *ds, const double *w, double k, int threads,
+                        GradJob *jobs, double *grad) {
+    pthread_t tids[TUNE_MAX_THREADS];
+    size_t chunk = (ds->n + (size_t)threads - 1) / (size_t)threads;
+    for (int t = 0; t < threads; ++t) {
+        jobs[t].ds = ds;
+        jobs[t].w = w;
+        jobs[t].k = k;
+        jobs[t].begin = (size_t)t * chunk < ds->n ? (size_t)t * chunk : ds->n;
+        jobs[t].end = jobs[t].begin + chunk < ds->n ? jobs[t].begin + chunk : ds->n;
+        if (jobs[t].grad) memset(jobs[t].grad, 0, EVAL_N_FEATURES * sizeof(double));
+    }
+    int started = 0;
+    for (int t = 1; t < threads; ++t) {
+        if (pthread_create(&tids[t - 1], NULL, grad_worker, &jobs[t]) != 0) break;
+        started++;
+    }
+    grad_worker(&jobs[0]);
+    for (int t = started + 1; t < threads; ++t) grad_worker(&jobs[t]);
+    for (int t = 0; t < started; ++t) pthread_join(tids[t], NULL);
+
+    double error = 0.0;
+    if (grad) memset(grad, 0, EVAL_N_FEATURES * sizeof(double));
+    for (int t = 0; t < threads; ++t) {
+        error += jobs[t].error;
+        if (!grad) continue;
+        for (int i = 0; i < EVAL_N_FEATURES; ++i) grad[i] += jobs[t].grad[i];
+    }
+    return error / (double)ds->n;
+}
+
+static double fit_k(const Dataset *ds, const double *w, int threads, GradJob *jobs) {
+    double lo = 0.1;
+    double hi = 4.0;
+    for (int it = 0; it < 40; ++it) {
+        double m1 = lo + (hi - lo) / 3.0;
+        double m2 = hi - (hi - lo) / 3.0;
+        if (run_epoch(ds, w, m1, threads, jobs, NULL) < run_epoch(ds, w, m2, threads, jobs, NULL)) hi = m2;
+        else lo = m1;
+    }
+    return (lo + hi) / 2.0;
+}
+
+static void write_table(FILE *f, const char *name, const int *v, int n) {
+    fprintf(f, "\nstatic const int %s[%d] = {\n", name, n);
+    for (int i = 0; i < n; ++i) {
+        if (i % 8 == 0) fprintf(f, "    ");
+        fprintf(f, "%3d%s", v[i], i + 1 == n ? "\n" : (i % 8 == 7 ? ",\n" : ", "));
+    }
+    fprintf(f, "};\n");
+}
+
+static void write_weights(FILE *f, const double *w) {
+    int iw[EVAL_N_FEATURES];
+    for (int i = 0; i < EVAL_N_FEATURES; ++i) iw[i] = (int)lround(w[i]);
+    fprintf(f, "#pragma once\n\n");
+    fprintf(f, "/* Evaluation weights; `./engine tune --write` regenerates this file. */\n\n");
+    fprintf(f, "#define BISHOP_PAIR_BONUS %d\n", iw[EVAL_F_BISHOP_PAIR]);
+    fprintf(f, "#define DOUBLED_PAWN_PENALTY %d\n", iw[EVAL_F_DOUBLED_PAWN]);
+    fprintf(f, "#define ISOLATED_PAWN_PENALTY %d\n", iw[EVAL_F_ISOLATED_PAWN]);
+    fprintf(f, "#define KING_KNIGHT_SQUARES %d\n", iw[EVAL_F_KING_KNIGHT]);
+    static const char *terms[EVAL_ATTACK_TERMS] = {
+        "MOBILITY_KNIGHT", "MOBILITY_BISHOP", "MOBILITY_ROOK", "MOBILITY_QUEEN", "KING_ZONE_ATTACK",
+        "PINNED_PENALTY", "HANGING_PENALTY", "THREAT_BY_PAWN", "THREAT_BY_MINOR"
+    };
+    for (int i = 0; i < EVAL_ATTACK_TERMS; ++i) fprintf(f, "#define %s %d\n", terms[i], iw[EVAL_F_MOBILITY + i]);
+    fprintf(f, "\n");
+    const int *pv = iw + EVAL_F_PIECE;
+    fprintf(f, "static const int PIECE_VALUE[13] = {\n");
+    fprintf(f, "    0, %d, %d, %d, %d, %d, 20000,\n", pv[0], pv[1], pv[2], pv[3], pv[4]);
+    fprintf(f, "    %d, %d, %d, %d, %d, 20000\n};\n", pv[0], pv[1], pv[2], pv[3], pv[4]);
+    static const char *names[6] = {"PST_PAWN", "PST_KNIGHT", "PST_BISHOP", "PST_ROOK", "PST_QUEEN", "PST_KING"};
+    for (int t = 0; t < 6; ++t) write_table(f, names[t], iw + EVAL_F_PST + t * 64, 64);
+}
+
+int tune_run(const TuneOptions *opt) {
+    engine_init();
+    int threads = opt->threads < 1 ? 1 : opt->threads > TUNE_MAX_THREADS ? TUNE_MAX_THREADS : opt->threads;
+    Dataset ds;
+    memset(&ds, 0, sizeof(ds));
+    uint64_t start = now_ms();
+    if (!load_dataset(&ds, opt->data_path, opt->limit)) {
+        fprintf(stderr, "tune: no labeled positions in %s\n", opt->data_path);
+        free(ds.raw);
+        return 1;
+    }
+    size_t loaded = ds.n_raw;
+    bool resolved = resolve_dataset(&ds, threads);
+    fprintf(stderr, "tune: %zu positions loaded, %zu resolved, %zu features, %llu ms\n",
+            loaded, ds.n, ds.n_features, (unsigned long long)(now_ms() - start));
+
+    GradJob *jobs = (GradJob *)calloc((size_t)threads, sizeof(GradJob));
+    double *w = (double *)calloc(EVAL_N_FEATURES, sizeof(double));
+    double *grad = (double *)calloc(EVAL_N_FEATURES, sizeof(double));
+    double *m = (double *)calloc(EVAL_N_FEATURES, sizeof(double));
+    double *v = (double *)calloc(EVAL_N_FEATURES, sizeof(double));
+    bool ok = resolved && ds.n > 0 && jobs && w && grad && m && v;
+    for (int t = 0; ok && t < threads; ++t) {
+        jobs[t].grad = (double *)calloc(EVAL_N_FEATURES, sizeof(double));
+        ok = jobs[t].grad != NULL;
+    }
+    if (ok) {
+        int iw[EVAL_N_FEATURES];
+        eval_get_weights(iw);
+        for (int i = 0; i < EVAL_N_FEATURES; ++i) w[i] = iw[i];
+        double k = fit_k(&ds, w, threads, jobs);
+        fprintf(stderr, "tune: K %.4f initial error %.6f\n", k, run_epoch(&ds, w, k, threads, jobs, NULL));
+
+        uint64_t epoch_start = now_ms();
+        double b1t = 1.0;
+        double b2t = 1.0;
+        for (int epoch = 1; epoch <= opt->epochs; ++epoch) {
+            double error = run_epoch(&ds, w, k, threads, jobs, grad);
+            b1t *= ADAM_BETA1;
+            b2t *= ADAM_BETA2;
+            for (int i = 0; i < EVAL_N_FEATURES; ++i) {
+                double g = grad[i] / (double)ds.n;
+                m[i] = ADAM_BETA1 * m[i] + (1.0 - ADAM_BETA1) * g;
+                v[i] = ADAM_BETA2 * v[i] + (1.0 - ADAM_BETA2) * g * g;
+                w[i] -= opt->lr * (m[i] / (1.0 - b1t)) / (sqrt(v[i] / (1.0 - b2t)) + ADAM_EPS);
+            }
+            if (epoch % 10 == 0 || epoch == opt->epochs) {
+                uint64_t ms = now_ms() - epoch_start;
+                fprintf(stderr, "tune: epoch %d error %.6f %.1f Mpos/s\n", epoch, error,
+                        ms ? (double)ds.n * epoch / (double)ms / 1000.0 : 0.0);
+            }
+        }
+        fprintf(stderr, "tune: final error %.6f\n", run_epoch(&ds, w, k, threads, jobs, NULL));
+
+        FILE *out = opt->write_path ? fopen(opt->write_path, "w") : stdout;
+        if (out) {
+            write_weights(out, w);
+            if (out != stdout) fclose(out);
+        } else {
+            fprintf(stderr, "tune: cannot write %s\n", opt->write_path);
+            ok = false;
+        }
+    }
+
+    for (int t = 0; jobs && t < threads; ++t) free(jobs[t].grad);
+    free(jobs);
+    free(w);
+    free(grad);
+    free(m);
+    free(v);
+    free(ds.offset);
+    free(ds.index);
+    free(ds.coef);
+    free(ds.result);
+    return ok ? 0 : 1;
+}
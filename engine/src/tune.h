@@ -0,0 +1,14 @@
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+
+typedef struct {
+    const char *data_path;
+    const char *write_path;
+    int epochs;
+    double lr;
+    int threads;
+    uint64_t limit;
+} TuneOptions;
+
+int tune_run(const TuneOptions *opt);
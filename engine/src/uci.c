@@ -4,34 +4,22 @@
 #include <ctype.h>
 #include <time.h>
 #include "uci.h"
-#include "position.h"
-#include "search.h"
-#include "zobrist.h"
-#include "movegen.h"
-#include "make.h"
-#include "perft.h"
+#include "chessv2.h"
+#include "perftsuite.h"
+#include "bench.h"
+#include "time.h"
 
-static Position POS;
-static SearchCtx CTX;
-static int LAST_FROM = -1;
-static int LAST_TO = -1;
-static Move MOVE_HISTORY[2048];
-static int MOVE_COUNT = 0;
-static int HUMAN_SIDE[2] = {1, 1};
-static int VS_MODE = 0;
-static int COMPUTER_MOVETIME_MS = 500;
-static int START_DELAY_MS = 0;
-static int PENDING_START_DELAY = 0;
+#define MAX_POSITION_MOVES 1024
 
-static const char *STARTPOS_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
-
-static void set_startpos(Position *p) {
-    pos_from_fen(p, STARTPOS_FEN);
-    LAST_FROM = -1;
-    LAST_TO = -1;
-    MOVE_COUNT = 0;
-    PENDING_START_DELAY = 1;
-}
+typedef struct {
+    ChessEngine *eng;
+    int uci_mode;
+    int human_side[2];
+    int vs_mode;
+    int computer_movetime_ms;
+    int start_delay_ms;
+    int pending_start_delay;
+} UciState;
 
 static void sleep_ms(int ms) {
     if (ms <= 0) return;
@@ -41,73 +29,27 @@ static void sleep_ms(int ms) {
     nanosleep(&ts, NULL);
 }
 
-static void move_to_uci(Move mv, char *out) {
-    int from = M_FROM(mv);
-    int to = M_TO(mv);
-    out[0] = (char)('a' + (from & 7));
-    out[1] = (char)('1' + (from >> 3));
-    out[2] = (char)('a' + (to & 7));
-    out[3] = (char)('1' + (to >> 3));
-    int idx = 4;
-    if (M_FLAGS(mv) & FLAG_PROMO) {
-        Piece p = M_PROMO(mv);
-        char c = 'q';
-        if (p == WR || p == BR) c = 'r';
-        else if (p == WB || p == BB) c = 'b';
-        else if (p == WN || p == BN) c = 'n';
-        out[idx++] = c;
-    }
-    out[idx] = '\0';
-}
-
-static Move uci_move_from_str(Position *pos, const char *str) {
-    MoveList list;
-    gen_pseudo_legal(pos, &list);
-    for (int i = 0; i < list.n; ++i) {
-        Move mv = list.m[i];
-        if (!is_legal_move(pos, mv)) continue;
-        char buf[6];
-        move_to_uci(mv, buf);
-        if (strlen(buf) == strlen(str) && !strcmp(buf, str)) return mv;
-    }
-    return 0;
-}
-
-static void record_move(Move mv) {
-    if (MOVE_COUNT < (int)(sizeof(MOVE_HISTORY) / sizeof(MOVE_HISTORY[0]))) {
-        MOVE_HISTORY[MOVE_COUNT++] = mv;
-    }
-}
+static void parse_position(UciState *u, char *line) {
+    const char *moves[MAX_POSITION_MOVES];
+    int n_moves = 0;
+    char fen[256] = {0};
+    bool has_fen = false;
 
-static void update_last_move_from_history(void) {
-    if (MOVE_COUNT > 0) {
-        Move mv = MOVE_HISTORY[MOVE_COUNT - 1];
-        LAST_FROM = M_FROM(mv);
-        LAST_TO = M_TO(mv);
-    } else {
-        LAST_FROM = -1;
-        LAST_TO = -1;
-    }
-}
-
-static void parse_position(Position *pos, char *line) {
     char *token = strtok(line, " \n");
     token = strtok(NULL, " \n");
     if (!token) return;
 
     if (!strcmp(token, "startpos")) {
-        set_startpos(pos);
         token = strtok(NULL, " \n");
     } else if (!strcmp(token, "fen")) {
-        char fen[256] = {0};
         char *ptr = fen;
         int parts = 0;
-        MOVE_COUNT = 0;
-        PENDING_START_DELAY = 1;
+        has_fen = true;
         while ((token = strtok(NULL, " \n")) != NULL) {
             if (!strcmp(token, "moves")) break;
-            if (parts > 0) *ptr++ = ' ';
             size_t len = strlen(token);
+            if ((size_t)(ptr - fen) + len + 2 > sizeof(fen)) break;
+            if (parts > 0) *ptr++ = ' ';
             memcpy(ptr, token, len);
             ptr += len;
             parts++;
@@ -116,30 +58,26 @@ static void parse_position(Position *pos, char *line) {
                 break;
             }
         }
-        pos_from_fen(pos, fen);
-        LAST_FROM = -1;
-        LAST_TO = -1;
+    } else {
+        return;
     }
 
     if (token && !strcmp(token, "moves")) {
-        while ((token = strtok(NULL, " \n")) != NULL) {
-            Move mv = uci_move_from_str(pos, token);
-            if (mv && make_move(pos, mv)) {
-                LAST_FROM = M_FROM(mv);
-                LAST_TO = M_TO(mv);
-                record_move(mv);
-            }
+        while ((token = strtok(NULL, " \n")) != NULL && n_moves < MAX_POSITION_MOVES) {
+            moves[n_moves++] = token;
         }
     }
+    chess_set_position(u->eng, has_fen ? fen : NULL, moves, n_moves);
+    u->pending_start_delay = 1;
 }
 
-static void parse_go(SearchLimits *lim, char *line) {
+static void parse_go(ChessLimits *lim, char *line) {
     memset(lim, 0, sizeof(*lim));
     char *token = strtok(line, " \n");
     while ((token = strtok(NULL, " \n")) != NULL) {
         if (!strcmp(token, "depth")) {
             token = strtok(NULL, " \n");
-            lim->max_depth = token ? atoi(token) : 0;
+            lim->depth = token ? atoi(token) : 0;
         } else if (!strcmp(token, "movetime")) {
             token = strtok(NULL, " \n");
             lim->movetime_ms = token ? atoi(token) : 0;
@@ -155,28 +93,85 @@ static void parse_go(SearchLimits *lim, char *line) {
         } else if (!strcmp(token, "binc")) {
             token = strtok(NULL, " \n");
             lim->binc_ms = token ? atoi(token) : 0;
+        } else if (!strcmp(token, "nodes")) {
+            token = strtok(NULL, " \n");
+            lim->nodes = token ? strtoull(token, NULL, 10) : 0;
+        } else if (!strcmp(token, "mate")) {
+            token = strtok(NULL, " \n");
+            lim->mate = token ? atoi(token) : 0;
         }
     }
 }
 
-static void maybe_play_computer(Position *pos) {
-    if (!VS_MODE) return;
-    if (HUMAN_SIDE[pos->side]) return;
-    if (PENDING_START_DELAY) {
-        sleep_ms(START_DELAY_MS);
-        PENDING_START_DELAY = 0;
+static void parse_setoption(UciState *u, char *line) {
+    char name[64] = {0};
+    char value[256] = {0};
+    char *dst = NULL;
+    size_t cap = 0;
+    char *token = strtok(line, " \n");
+    while ((token = strtok(NULL, " \n")) != NULL) {
+        if (!strcmp(token, "name")) {
+            dst = name;
+            cap = sizeof(name);
+        } else if (!strcmp(token, "value")) {
+            dst = value;
+            cap = sizeof(value);
+        } else if (dst) {
+            size_t len = strlen(dst);
+            if (len && len + 1 < cap) dst[len++] = ' ';
+            snprintf(dst + len, cap - len, "%s", token);
+        }
+    }
+    if (!chess_set_option(u->eng, name, value)) {
+        printf("info string invalid option %s\n", name);
+        fflush(stdout);
+    }
+}
+
+static void print_divide(const char *move, uint64_t nodes, void *user) {
+    (void)user;
+    printf("%s: %llu\n", move, (unsigned long long)nodes);
+}
+
+static void print_perft(const char *cmd, int depth, uint64_t nodes, uint64_t ms) {
+    uint64_t nps = ms ? nodes * 1000u / ms : nodes;
+    printf("%s %d nodes %llu time %llu nps %llu\n", cmd, depth,
+           (unsigned long long)nodes, (unsigned long long)ms, (unsigned long long)nps);
+    fflush(stdout);
+}
+
+static void print_info(const ChessInfo *info, void *user) {
+    (void)user;
+    if (info->mate) {
+        printf("info depth %d score mate %d", info->depth, info->mate);
+    } else {
+        printf("info depth %d score cp %d", info->depth, info->score_cp);
     }
-    SearchLimits lim;
+    uint64_t nps = info->time_ms ? info->nodes * 1000u / info->time_ms : info->nodes;
+    printf(" nodes %llu time %llu nps %llu tbhits %llu pv %s\n",
+           (unsigned long long)info->nodes,
+           (unsigned long long)info->time_ms,
+           (unsigned long long)nps,
+           (unsigned long long)info->tbhits,
+           info->pv[0] ? info->pv : info->bestmove);
+    fflush(stdout);
+}
+
+static void maybe_play_computer(UciState *u) {
+    if (!u->vs_mode) return;
+    int side = chess_side_to_move(u->eng);
+    if (u->human_side[side]) return;
+    if (u->pending_start_delay) {
+        sleep_ms(u->start_delay_ms);
+        u->pending_start_delay = 0;
+    }
+    ChessLimits lim;
     memset(&lim, 0, sizeof(lim));
-    lim.movetime_ms = COMPUTER_MOVETIME_MS;
-    int moved_side = pos->side;
-    Move best = search_bestmove(&CTX, pos, &lim);
-    if (best && make_move(pos, best)) {
-        record_move(best);
-        LAST_FROM = M_FROM(best);
-        LAST_TO = M_TO(best);
-        printf("computer %s\n", moved_side == WHITE ? "white" : "black");
-        pos_print_pretty(pos, LAST_FROM, LAST_TO);
+    lim.movetime_ms = u->computer_movetime_ms;
+    ChessInfo info;
+    if (chess_search(u->eng, &lim, NULL, NULL, &info) && chess_push_move(u->eng, info.bestmove)) {
+        printf("computer %s\n", side == CHESS_WHITE ? "white" : "black");
+        chess_print_board(u->eng);
         fflush(stdout);
     } else {
         printf("computer has no legal moves\n");
@@ -186,76 +181,88 @@ static void maybe_play_computer(Position *pos) {
 
 void uci_loop(void) {
     char line[4096];
-    zobrist_init(20260202ULL);
-    search_init(&CTX, 128);
-    set_startpos(&POS);
+    UciState u;
+    memset(&u, 0, sizeof(u));
+    u.human_side[CHESS_WHITE] = 1;
+    u.human_side[CHESS_BLACK] = 1;
+    u.computer_movetime_ms = 500;
+    u.pending_start_delay = 1;
+    u.eng = chess_engine_new(128);
+    if (!u.eng) return;
 
     while (fgets(line, sizeof(line), stdin)) {
-        if (!strncmp(line, "uci", 3)) {
+        if (!strncmp(line, "ucinewgame", 10)) {
+            chess_new_game(u.eng);
+            u.pending_start_delay = 1;
+        } else if (!strncmp(line, "uci", 3)) {
+            u.uci_mode = 1;
             printf("id name CEngine\n");
             printf("id author you\n");
+            printf("option name Hash type spin default 128 min 1 max 65536\n");
+            printf("option name Threads type spin default 1 min 1 max 1024\n");
+            printf("option name PerftHash type spin default 0 min 0 max 65536\n");
+            printf("option name TraceFile type string default <empty>\n");
+            printf("option name BookFile type string default <empty>\n");
+            printf("option name BookDepth type spin default %d min 0 max 2048\n", CHESS_BOOK_DEPTH);
+            printf("option name BookBestMove type check default false\n");
+            printf("option name SyzygyPath type string default <empty>\n");
+            printf("option name SyzygyProbeLimit type spin default %d min 0 max 7\n", CHESS_TB_PROBE_LIMIT);
             printf("uciok\n");
             fflush(stdout);
         } else if (!strncmp(line, "isready", 7)) {
             printf("readyok\n");
             fflush(stdout);
-        } else if (!strncmp(line, "ucinewgame", 10)) {
-            set_startpos(&POS);
         } else if (!strncmp(line, "position", 8)) {
-            parse_position(&POS, line);
-            pos_print_pretty(&POS, LAST_FROM, LAST_TO);
-            fflush(stdout);
+            parse_position(&u, line);
+            if (!u.uci_mode) {
+                chess_print_board(u.eng);
+                fflush(stdout);
+            }
         } else if (!strncmp(line, "mode", 4)) {
-            char *token = strtok(line, " \n");
+            strtok(line, " \n");
             char *color = strtok(NULL, " \n");
             char *role = strtok(NULL, " \n");
             if (color && role) {
-                VS_MODE = 1;
+                u.vs_mode = 1;
                 if (!strcmp(color, "white")) {
-                    HUMAN_SIDE[WHITE] = !strcmp(role, "human");
-                    HUMAN_SIDE[BLACK] = !HUMAN_SIDE[WHITE];
+                    u.human_side[CHESS_WHITE] = !strcmp(role, "human");
+                    u.human_side[CHESS_BLACK] = !u.human_side[CHESS_WHITE];
                 } else if (!strcmp(color, "black")) {
-                    HUMAN_SIDE[BLACK] = !strcmp(role, "human");
-                    HUMAN_SIDE[WHITE] = !HUMAN_SIDE[BLACK];
+                    u.human_side[CHESS_BLACK] = !strcmp(role, "human");
+                    u.human_side[CHESS_WHITE] = !u.human_side[CHESS_BLACK];
                 }
                 printf("mode white %s vs black %s\n",
-                       HUMAN_SIDE[WHITE] ? "human" : "computer",
-                       HUMAN_SIDE[BLACK] ? "human" : "computer");
+                       u.human_side[CHESS_WHITE] ? "human" : "computer",
+                       u.human_side[CHESS_BLACK] ? "human" : "computer");
                 fflush(stdout);
-                maybe_play_computer(&POS);
+                maybe_play_computer(&u);
             } else {
                 printf("usage: mode <white|black> <human|computer>\n");
                 fflush(stdout);
             }
         } else if (!strncmp(line, "thinktime", 9)) {
             int ms = atoi(line + 9);
-            if (ms > 0) COMPUTER_MOVETIME_MS = ms;
-            printf("thinktime %d\n", COMPUTER_MOVETIME_MS);
+            if (ms > 0) u.computer_movetime_ms = ms;
+            printf("thinktime %d\n", u.computer_movetime_ms);
             fflush(stdout);
         } else if (!strncmp(line, "startdelay", 10)) {
             int ms = atoi(line + 10);
-            if (ms >= 0) START_DELAY_MS = ms;
-            printf("startdelay %d\n", START_DELAY_MS);
+            if (ms >= 0) u.start_delay_ms = ms;
+            printf("startdelay %d\n", u.start_delay_ms);
             fflush(stdout);
         } else if (!strncmp(line, "move", 4)) {
-            char *token = strtok(line, " \n");
+            strtok(line, " \n");
             char *uci = strtok(NULL, " \n");
             if (!uci) {
                 printf("usage: move <uci>\n");
                 fflush(stdout);
+            } else if (chess_push_move(u.eng, uci)) {
+                chess_print_board(u.eng);
+                fflush(stdout);
+                maybe_play_computer(&u);
             } else {
-                Move mv = uci_move_from_str(&POS, uci);
-                if (mv && make_move(&POS, mv)) {
-                    record_move(mv);
-                    LAST_FROM = M_FROM(mv);
-                    LAST_TO = M_TO(mv);
-                    pos_print_pretty(&POS, LAST_FROM, LAST_TO);
-                    fflush(stdout);
-                    maybe_play_computer(&POS);
-                } else {
-                    printf("illegal move %s\n", uci);
-                    fflush(stdout);
-                }
+                printf("illegal move %s\n", uci);
+                fflush(stdout);
             }
         } else if (!strncmp(line, "undo", 4)) {
             int count = 1;
@@ -263,34 +270,60 @@ void uci_loop(void) {
                 count = atoi(line + 4);
                 if (count <= 0) count = 1;
             }
-            while (count-- > 0 && MOVE_COUNT > 0) {
-                Move mv = MOVE_HISTORY[--MOVE_COUNT];
-                undo_move(&POS, mv);
+            while (count-- > 0 && chess_pop_move(u.eng)) {
             }
-            update_last_move_from_history();
-            pos_print_pretty(&POS, LAST_FROM, LAST_TO);
+            chess_print_board(u.eng);
             fflush(stdout);
         } else if (!strncmp(line, "go", 2)) {
-            SearchLimits lim;
+            ChessLimits lim;
+            ChessInfo info;
             parse_go(&lim, line);
-            Move best = search_bestmove(&CTX, &POS, &lim);
-            char buf[8];
-            if (best) move_to_uci(best, buf);
-            else strcpy(buf, "0000");
-            printf("bestmove %s\n", buf);
+            chess_search(u.eng, &lim, print_info, NULL, &info);
+            printf("bestmove %s\n", info.bestmove);
             fflush(stdout);
         } else if (!strncmp(line, "show", 4) || !strncmp(line, "display", 7)) {
-            pos_print_pretty(&POS, LAST_FROM, LAST_TO);
+            chess_print_board(u.eng);
+            fflush(stdout);
+        } else if (!strncmp(line, "stats", 5)) {
+            chess_print_stats(u.eng);
+        } else if (!strncmp(line, "setoption", 9)) {
+            parse_setoption(&u, line);
+        } else if (!strncmp(line, "divide", 6)) {
+            int depth = atoi(line + 6);
+            uint64_t start = now_ms();
+            uint64_t nodes = chess_divide(u.eng, depth, print_divide, NULL);
+            printf("\n");
+            print_perft("divide", depth, nodes, now_ms() - start);
+        } else if (!strncmp(line, "perftsuite", 10)) {
+            strtok(line, " \n");
+            char *path = strtok(NULL, " \n");
+            char *depth = strtok(NULL, " \n");
+            if (path) perft_suite_run(u.eng, path, depth ? atoi(depth) : 0);
+            else printf("usage: perftsuite <file.epd> [max_depth]\n");
             fflush(stdout);
         } else if (!strncmp(line, "perft", 5)) {
             int depth = atoi(line + 6);
-            uint64_t nodes = perft(&POS, depth);
-            printf("perft %d nodes %llu\n", depth, (unsigned long long)nodes);
+            uint64_t start = now_ms();
+            uint64_t nodes = chess_perft(u.eng, depth);
+            print_perft("perft", depth, nodes, now_ms() - start);
+        } else if (!strncmp(line, "bench", 5)) {
+            strtok(line, " \n");
+            char *hash = strtok(NULL, " \n");
+            char *threads = strtok(NULL, " \n");
+            char *depth = strtok(NULL, " \n");
+            int h = hash ? atoi(hash) : BENCH_DEFAULT_HASH;
+            int t = threads ? atoi(threads) : BENCH_DEFAULT_THREADS;
+            int d = depth ? atoi(depth) : BENCH_DEFAULT_DEPTH;
+            BenchResult res;
+            bench_run((size_t)(h > 0 ? h : 1), t > 0 ? t : 1, d > 0 ? d : 1, &res);
+            bench_print(&res);
+        } else if (!strncmp(line, "eval", 4)) {
+            printf("eval %d\n", chess_eval(u.eng));
             fflush(stdout);
         } else if (!strncmp(line, "quit", 4)) {
             break;
         }
     }
 
-    search_quit(&CTX);
+    chess_engine_free(u.eng);
 }
@@ -0,0 +1,159 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "chessv2.h"
+
+#define ITERATIONS 2000
+
+typedef struct {
+    FILE *to;
+    FILE *from;
+    pid_t pid;
+} Pipe;
+
+static const char *GAME_MOVES[] = {
+    "e2e4", "e7e5", "g1f3", "b8c6", "f1b5", "a7a6", "b5a4", "g8f6",
+    "e1g1", "f8e7", "f1e1", "b7b5", "a4b3", "d7d6", "c2c3", "e8g8"
+};
+#define N_GAME_MOVES ((int)(sizeof(GAME_MOVES) / sizeof(GAME_MOVES[0])))
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char *name, uint64_t *samples, int n) {
+    qsort(samples, (size_t)n, sizeof(samples[0]), cmp_u64);
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) sum += (double)samples[i];
+    printf("%-24s mean %9.1f us  p50 %9.1f us  p99 %9.1f us\n", name,
+           sum / n / 1000.0,
+           (double)samples[n / 2] / 1000.0,
+           (double)samples[n * 99 / 100] / 1000.0);
+}
+
+static bool pipe_open(Pipe *p, const char *path) {
+    int in[2], out[2];
+    if (pipe(in) || pipe(out)) return false;
+    p->pid = fork();
+    if (p->pid < 0) return false;
+    if (p->pid == 0) {
+        dup2(in[0], 0);
+        dup2(out[1], 1);
+        close(in[1]);
+        close(out[0]);
+        execl(path, path, (char *)NULL);
+        _exit(127);
+    }
+    close(in[0]);
+    close(out[1]);
+    p->to = fdopen(in[1], "w");
+    p->from = fdopen(out[0], "r");
+    return p->to && p->from;
+}
+
+static void pipe_close(Pipe *p) {
+    fprintf(p->to, "quit\n");
+    fclose(p->to);
+    fclose(p->from);
+    waitpid(p->pid, NULL, 0);
+}
+
+static bool pipe_wait_for(Pipe *p, const char *prefix) {
+    char line[4096];
+    size_t len = strlen(prefix);
+    while (fgets(line, sizeof(line), p->from)) {
+        if (!strncmp(line, prefix, len)) return true;
+    }
+    return false;
+}
+
+static void position_cmd(char *buf, size_t size, int n_moves) {
+    int off = snprintf(buf, size, "position startpos moves");
+    for (int i = 0; i < n_moves; ++i) {
+        off += snprintf(buf + off, size - (size_t)off, " %s", GAME_MOVES[i]);
+    }
+}
+
+static void bench_pipe(const char *path, uint64_t *samples) {
+    Pipe p;
+    char cmd[512];
+    if (!pipe_open(&p, path)) {
+        fprintf(stderr, "cannot start %s\n", path);
+        exit(1);
+    }
+    fprintf(p.to, "uci\n");
+    fflush(p.to);
+    pipe_wait_for(&p, "uciok");
+
+    for (int i = 0; i < ITERATIONS; ++i) {
+        position_cmd(cmd, sizeof(cmd), i % N_GAME_MOVES + 1);
+        uint64_t t0 = now_ns();
+        fprintf(p.to, "%s\neval\n", cmd);
+        fflush(p.to);
+        pipe_wait_for(&p, "eval");
+        samples[i] = now_ns() - t0;
+    }
+    report("pipe position+eval", samples, ITERATIONS);
+
+    for (int i = 0; i < ITERATIONS; ++i) {
+        position_cmd(cmd, sizeof(cmd), i % N_GAME_MOVES + 1);
+        uint64_t t0 = now_ns();
+        fprintf(p.to, "%s\ngo depth 1\n", cmd);
+        fflush(p.to);
+        pipe_wait_for(&p, "bestmove");
+        samples[i] = now_ns() - t0;
+    }
+    report("pipe position+go d1", samples, ITERATIONS);
+    pipe_close(&p);
+}
+
+static void bench_api(uint64_t *samples) {
+    ChessEngine *eng = chess_engine_new(128);
+    if (!eng) {
+        fprintf(stderr, "cannot create engine\n");
+        exit(1);
+    }
+    volatile int sink = 0;
+    for (int i = 0; i < ITERATIONS; ++i) {
+        uint64_t t0 = now_ns();
+        chess_set_position(eng, NULL, GAME_MOVES, i % N_GAME_MOVES + 1);
+        sink += chess_eval(eng);
+        samples[i] = now_ns() - t0;
+    }
+    report("api position+eval", samples, ITERATIONS);
+
+    ChessLimits lim;
+    memset(&lim, 0, sizeof(lim));
+    lim.depth = 1;
+    for (int i = 0; i < ITERATIONS; ++i) {
+        ChessInfo info;
+        uint64_t t0 = now_ns();
+        chess_set_position(eng, NULL, GAME_MOVES, i % N_GAME_MOVES + 1);
+        chess_search(eng, &lim, NULL, NULL, &info);
+        samples[i] = now_ns() - t0;
+    }
+    report("api position+go d1", samples, ITERATIONS);
+    chess_engine_free(eng);
+    (void)sink;
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "./engine";
+    static uint64_t samples[ITERATIONS];
+    bench_pipe(path, samples);
+    bench_api(samples);
+    return 0;
+}
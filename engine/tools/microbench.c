@@ -0,0 +1,241 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "init.h"
+#include "position.h"
+#include "movegen.h"
+#include "make.h"
+#include "attack.h"
+#include "tables.h"
+#include "eval.h"
+#include "tt.h"
+
+#define MAX_CORPUS 256
+#define MAX_TRIALS 101
+#define DEFAULT_TRIALS 21
+#define TARGET_TRIAL_NS 20000000ull
+
+typedef struct {
+    Position *pos;
+    MoveList *moves;
+    int n;
+    uint64_t *keys;
+    int n_keys;
+    TT tt;
+} Corpus;
+
+typedef uint64_t (*BenchFn)(Corpus *c, uint64_t *sink);
+
+static volatile uint64_t g_sink;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t bench_movegen(Corpus *c, uint64_t *sink) {
+    MoveList list;
+    for (int i = 0; i < c->n; ++i) {
+        gen_pseudo_legal(&c->pos[i], &list);
+        *sink += (uint64_t)list.n;
+    }
+    return (uint64_t)c->n;
+}
+
+static uint64_t bench_make_undo(Corpus *c, uint64_t *sink) {
+    uint64_t ops = 0;
+    for (int i = 0; i < c->n; ++i) {
+        Position *pos = &c->pos[i];
+        const MoveList *list = &c->moves[i];
+        for (int j = 0; j < list->n; ++j) {
+            if (make_move(pos, list->m[j])) {
+                *sink += pos->key;
+                undo_move(pos, list->m[j]);
+            }
+        }
+        ops += (uint64_t)list->n;
+    }
+    return ops;
+}
+
+static uint64_t bench_attacked(Corpus *c, uint64_t *sink) {
+    for (int i = 0; i < c->n; ++i) {
+        for (int sq = 0; sq < 64; ++sq) {
+            *sink += is_square_attacked(&c->pos[i], sq, sq & 1);
+        }
+    }
+    return (uint64_t)c->n * 64u;
+}
+
+static uint64_t bench_rook(Corpus *c, uint64_t *sink) {
+    for (int i = 0; i < c->n; ++i) {
+        U64 occ = c->pos[i].occ;
+        for (int sq = 0; sq < 64; ++sq) *sink += rook_attacks(sq, occ);
+    }
+    return (uint64_t)c->n * 64u;
+}
+
+static uint64_t bench_bishop(Corpus *c, uint64_t *sink) {
+    for (int i = 0; i < c->n; ++i) {
+        U64 occ = c->pos[i].occ;
+        for (int sq = 0; sq < 64; ++sq) *sink += bishop_attacks(sq, occ);
+    }
+    return (uint64_t)c->n * 64u;
+}
+
+static uint64_t bench_eval(Corpus *c, uint64_t *sink) {
+    for (int i = 0; i < c->n; ++i) *sink += (uint64_t)eval(&c->pos[i]);
+    return (uint64_t)c->n;
+}
+
+static uint64_t bench_tt_probe(Corpus *c, uint64_t *sink) {
+    for (int i = 0; i < c->n_keys; ++i) {
+        TTEntry *e = tt_probe(&c->tt, c->keys[i]);
+        *sink += e ? e->depth : 1u;
+    }
+    return (uint64_t)c->n_keys;
+}
+
+static const struct {
+    const char *name;
+    BenchFn fn;
+} BENCHES[] = {
+    {"gen_pseudo_legal", bench_movegen},
+    {"make_undo", bench_make_undo},
+    {"is_square_attacked", bench_attacked},
+    {"rook_attacks", bench_rook},
+    {"bishop_attacks", bench_bishop},
+    {"eval", bench_eval},
+    {"tt_probe", bench_tt_probe},
+};
+#define N_BENCHES ((int)(sizeof(BENCHES) / sizeof(BENCHES[0])))
+
+static bool load_corpus(Corpus *c, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    c->pos = (Position *)malloc(MAX_CORPUS * sizeof(Position));
+    c->moves = (MoveList *)malloc(MAX_CORPUS * sizeof(MoveList));
+    if (!c->pos || !c->moves) {
+        fclose(f);
+        return false;
+    }
+    char line[1024];
+    c->n = 0;
+    while (c->n < MAX_CORPUS && fgets(line, sizeof(line), f)) {
+        if (line[0] == '#') continue;
+        line[strcspn(line, ";\r\n")] = '\0';
+        size_t len = strlen(line);
+        while (len > 0 && line[len - 1] == ' ') line[--len] = '\0';
+        if (!len || !pos_from_fen(&c->pos[c->n], line)) continue;
+        gen_pseudo_legal(&c->pos[c->n], &c->moves[c->n]);
+        c->n++;
+    }
+    fclose(f);
+    if (c->n == 0) return false;
+
+    int cap = 0;
+    for (int i = 0; i < c->n; ++i) cap += c->moves[i].n;
+    c->keys = (uint64_t *)malloc((size_t)cap * sizeof(uint64_t));
+    if (!c->keys) return false;
+    tt_init(&c->tt, 16);
+    c->n_keys = 0;
+    for (int i = 0; i < c->n; ++i) {
+        Position *pos = &c->pos[i];
+        for (int j = 0; j < c->moves[i].n; ++j) {
+            Move mv = c->moves[i].m[j];
+            if (!make_move(pos, mv)) continue;
+            c->keys[c->n_keys] = pos->key;
+            if (c->n_keys & 1) tt_store(&c->tt, pos->key, j & 15, 0, TT_EXACT, mv, TT_EVAL_NONE);
+            c->n_keys++;
+            undo_move(pos, mv);
+        }
+    }
+    return true;
+}
+
+static void free_corpus(Corpus *c) {
+    free(c->pos);
+    free(c->moves);
+    free(c->keys);
+    tt_free(&c->tt);
+}
+
+static int run(Corpus *c, int trials, bool csv) {
+    if (csv) {
+        printf("name,ops_per_trial,trials,min_ns,p10_ns,p50_ns,p90_ns,max_ns\n");
+    } else {
+        printf("%-20s %10s %9s %9s %9s %9s %9s\n", "primitive", "ops/trial",
+               "min ns", "p10 ns", "p50 ns", "p90 ns", "max ns");
+    }
+    for (int b = 0; b < N_BENCHES; ++b) {
+        uint64_t sink = 0;
+        uint64_t start = now_ns();
+        uint64_t ops = BENCHES[b].fn(c, &sink);
+        uint64_t once = now_ns() - start;
+        uint64_t reps = once ? TARGET_TRIAL_NS / once : 1;
+        if (reps == 0) reps = 1;
+        for (uint64_t r = 0; r < reps; ++r) BENCHES[b].fn(c, &sink);
+
+        double samples[MAX_TRIALS];
+        for (int t = 0; t < trials; ++t) {
+            start = now_ns();
+            for (uint64_t r = 0; r < reps; ++r) BENCHES[b].fn(c, &sink);
+            samples[t] = (double)(now_ns() - start) / (double)(ops * reps);
+        }
+        g_sink += sink;
+        qsort(samples, (size_t)trials, sizeof(samples[0]), cmp_double);
+        double p10 = samples[trials / 10];
+        double p50 = samples[trials / 2];
+        double p90 = samples[trials * 9 / 10];
+        if (csv) {
+            printf("%s,%llu,%d,%.3f,%.3f,%.3f,%.3f,%.3f\n", BENCHES[b].name,
+                   (unsigned long long)(ops * reps), trials,
+                   samples[0], p10, p50, p90, samples[trials - 1]);
+        } else {
+            printf("%-20s %10llu %9.2f %9.2f %9.2f %9.2f %9.2f\n", BENCHES[b].name,
+                   (unsigned long long)(ops * reps),
+                   samples[0], p10, p50, p90, samples[trials - 1]);
+        }
+        fflush(stdout);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *path = "tests/perft.epd";
+    int trials = DEFAULT_TRIALS;
+    bool csv = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--csv")) {
+            csv = true;
+        } else if (!strcmp(argv[i], "--trials") && i + 1 < argc) {
+            trials = atoi(argv[++i]);
+        } else {
+            path = argv[i];
+        }
+    }
+    if (trials < 1) trials = 1;
+    if (trials > MAX_TRIALS) trials = MAX_TRIALS;
+
+    engine_init();
+    Corpus c;
+    memset(&c, 0, sizeof(c));
+    if (!load_corpus(&c, path)) {
+        fprintf(stderr, "microbench: cannot load positions from %s\n", path);
+        free_corpus(&c);
+        return 2;
+    }
+    if (!csv) printf("%d positions from %s, %d trials\n", c.n, path, trials);
+    int rc = run(&c, trials, csv);
+    free_corpus(&c);
+    return rc;
+}
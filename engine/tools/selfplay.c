@@ -0,0 +1,396 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "chessv2.h"
+
+#define MAX_OPTIONS 16
+#define MAX_OPENINGS 4096
+#define MAX_CONCURRENCY 256
+#define MAX_GAME_PLIES 600
+#define CMD_SIZE (MAX_GAME_PLIES * 6 + 256)
+
+typedef struct {
+    const char *path;
+    const char *name;
+    const char *options[MAX_OPTIONS];
+    int n_options;
+} EngineSpec;
+
+typedef struct {
+    int depth;
+    uint64_t nodes;
+    int movetime_ms;
+    int base_ms;
+    int inc_ms;
+} Control;
+
+typedef struct {
+    FILE *to;
+    FILE *from;
+    pid_t pid;
+} Pipe;
+
+typedef struct {
+    EngineSpec eng[2];
+    Control tc;
+    char (*openings)[128];
+    int n_openings;
+    int games;
+    int concurrency;
+    bool sprt;
+    double elo0, elo1, alpha, beta;
+
+    atomic_int next_game;
+    atomic_int abort;
+    pthread_mutex_t lock;
+    int wins, draws, losses;
+    int finished;
+    int time_losses;
+    int illegal;
+} Match;
+
+static uint64_t now_ms_wall(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+/* Pipes are close-on-exec, so an engine started while other workers are forking inherits none of
+ * their pipe ends and each engine sees EOF as soon as its own peer goes away. */
+static bool pipe_open(Pipe *p, const char *path) {
+    int in[2], out[2];
+    if (pipe2(in, O_CLOEXEC) || pipe2(out, O_CLOEXEC)) return false;
+    p->pid = fork();
+    if (p->pid < 0) return false;
+    if (p->pid == 0) {
+        dup2(in[0], 0);
+        dup2(out[1], 1);
+        close(in[0]);
+        close(in[1]);
+        close(out[0]);
+        close(out[1]);
+        execl(path, path, (char *)NULL);
+        _exit(127);
+    }
+    close(in[0]);
+    close(out[1]);
+    p->to = fdopen(in[1], "w");
+    p->from = fdopen(out[0], "r");
+    return p->to && p->from;
+}
+
+static void pipe_close(Pipe *p) {
+    if (p->to) {
+        fprintf(p->to, "quit\n");
+        fclose(p->to);
+    }
+    if (p->from) fclose(p->from);
+    if (p->pid > 0) waitpid(p->pid, NULL, 0);
+    memset(p, 0, sizeof(*p));
+}
+
+static bool pipe_wait_for(Pipe *p, const char *prefix, char *line, size_t size) {
+    size_t len = strlen(prefix);
+    while (fgets(line, (int)size, p->from)) {
+        if (!strncmp(line, prefix, len)) return true;
+    }
+    return false;
+}
+
+static bool engine_start(Pipe *p, const EngineSpec *spec) {
+    char line[1024];
+    if (!pipe_open(p, spec->path)) return false;
+    fprintf(p->to, "uci\n");
+    fflush(p->to);
+    if (!pipe_wait_for(p, "uciok", line, sizeof(line))) return false;
+    for (int i = 0; i < spec->n_options; ++i) {
+        char name[128];
+        const char *eq = strchr(spec->options[i], '=');
+        if (!eq || (size_t)(eq - spec->options[i]) >= sizeof(name)) continue;
+        memcpy(name, spec->options[i], (size_t)(eq - spec->options[i]));
+        name[eq - spec->options[i]] = '\0';
+        fprintf(p->to, "setoption name %s value %s\n", name, eq + 1);
+    }
+    fprintf(p->to, "isready\n");
+    fflush(p->to);
+    return pipe_wait_for(p, "readyok", line, sizeof(line));
+}
+
+static void go_cmd(const Control *tc, const int clock_ms[2], char *buf, size_t size) {
+    if (tc->nodes) snprintf(buf, size, "go nodes %llu\n", (unsigned long long)tc->nodes);
+    else if (tc->depth) snprintf(buf, size, "go depth %d\n", tc->depth);
+    else if (tc->movetime_ms) snprintf(buf, size, "go movetime %d\n", tc->movetime_ms);
+    else snprintf(buf, size, "go wtime %d btime %d winc %d binc %d\n",
+                  clock_ms[CHESS_WHITE], clock_ms[CHESS_BLACK], tc->inc_ms, tc->inc_ms);
+}
+
+/* Plays one game; returns the score of engine 0 as 0, 1 or 2 half-points, or -1 on failure. */
+static int play_game(Match *m, Pipe pipes[2], ChessEngine *ref, const char *opening, int white) {
+    char cmd[CMD_SIZE];
+    char line[4096];
+    char go[128];
+    int clock_ms[2] = {m->tc.base_ms, m->tc.base_ms};
+    int off = snprintf(cmd, sizeof(cmd), "position fen %s moves", opening);
+    for (int e = 0; e < 2; ++e) {
+        fprintf(pipes[e].to, "ucinewgame\nisready\n");
+        fflush(pipes[e].to);
+        if (!pipe_wait_for(&pipes[e], "readyok", line, sizeof(line))) return -1;
+    }
+    if (!chess_set_position(ref, opening, NULL, 0)) return -1;
+
+    for (int ply = 0; ply < MAX_GAME_PLIES; ++ply) {
+        ChessStatus st = chess_status(ref);
+        int stm = chess_side_to_move(ref);
+        int mover = stm == CHESS_WHITE ? white : 1 - white;
+        if (st == CHESS_CHECKMATE) return mover == 0 ? 0 : 2;
+        if (st != CHESS_ONGOING) return 1;
+
+        go_cmd(&m->tc, clock_ms, go, sizeof(go));
+        uint64_t t0 = now_ms_wall();
+        fprintf(pipes[mover].to, "%s\n%s", cmd, go);
+        fflush(pipes[mover].to);
+        if (!pipe_wait_for(&pipes[mover], "bestmove", line, sizeof(line))) return -1;
+        uint64_t used = now_ms_wall() - t0;
+        if (m->tc.base_ms) {
+            clock_ms[stm] -= (int)used;
+            if (clock_ms[stm] < 0) {
+                pthread_mutex_lock(&m->lock);
+                m->time_losses++;
+                pthread_mutex_unlock(&m->lock);
+                return mover == 0 ? 0 : 2;
+            }
+            clock_ms[stm] += m->tc.inc_ms;
+        }
+
+        char mv[16] = {0};
+        sscanf(line, "bestmove %15s", mv);
+        if (!chess_push_move(ref, mv)) {
+            pthread_mutex_lock(&m->lock);
+            m->illegal++;
+            pthread_mutex_unlock(&m->lock);
+            fprintf(stderr, "selfplay: %s played illegal move '%s' in %s\n", m->eng[mover].name, mv, opening);
+            return mover == 0 ? 0 : 2;
+        }
+        if ((size_t)off + strlen(mv) + 2 >= sizeof(cmd)) return 1;
+        off += snprintf(cmd + off, sizeof(cmd) - (size_t)off, " %s", mv);
+    }
+    return 1;
+}
+
+static double score_to_elo(double s) {
+    if (s <= 0.0) return -INFINITY;
+    if (s >= 1.0) return INFINITY;
+    return -400.0 * log10(1.0 / s - 1.0);
+}
+
+static double elo_to_score(double elo) {
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+static double game_variance(int w, int d, int l, double *mean) {
+    double n = (double)(w + d + l);
+    double s = ((double)w + 0.5 * (double)d) / n;
+    *mean = s;
+    return ((double)w * (1.0 - s) * (1.0 - s) + (double)d * (0.5 - s) * (0.5 - s) + (double)l * s * s) / n;
+}
+
+static double sprt_llr(const Match *m, int w, int d, int l) {
+    if (w + d + l == 0 || (w == 0 && l == 0) || (d == 0 && (w == 0 || l == 0))) return 0.0;
+    double s = 0.0;
+    double var = game_variance(w, d, l, &s);
+    if (var <= 0.0) return 0.0;
+    double s0 = elo_to_score(m->elo0);
+    double s1 = elo_to_score(m->elo1);
+    return (double)(w + d + l) * (s1 - s0) * (2.0 * s - s0 - s1) / (2.0 * var);
+}
+
+static void report(const Match *m, bool final) {
+    int w = m->wins, d = m->draws, l = m->losses;
+    int n = w + d + l;
+    if (n == 0) return;
+    double s = 0.0;
+    double var = game_variance(w, d, l, &s);
+    double se = sqrt(var / (double)n);
+    double elo = score_to_elo(s);
+    double lo = score_to_elo(s - 1.96 * se);
+    double hi = score_to_elo(s + 1.96 * se);
+    if (elo == 0.0) elo = 0.0;
+    printf("%s %d games: %s vs %s +%d =%d -%d score %.1f%% elo %.1f +/- %.1f",
+           final ? "final" : "after", n, m->eng[0].name, m->eng[1].name, w, d, l, 100.0 * s,
+           elo, (hi - lo) / 2.0);
+    if (m->sprt) {
+        double llr = sprt_llr(m, w, d, l);
+        double lower = log(m->beta / (1.0 - m->alpha));
+        double upper = log((1.0 - m->beta) / m->alpha);
+        const char *verdict = llr >= upper ? "H1 accepted" : llr <= lower ? "H0 accepted" : "continue";
+        printf(" llr %.2f [%.2f, %.2f] %s", llr, lower, upper, verdict);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static bool sprt_done(const Match *m) {
+    if (!m->sprt) return false;
+    double llr = sprt_llr(m, m->wins, m->draws, m->losses);
+    return llr >= log((1.0 - m->beta) / m->alpha) || llr <= log(m->beta / (1.0 - m->alpha));
+}
+
+static void *game_worker(void *arg) {
+    Match *m = (Match *)arg;
+    Pipe pipes[2];
+    memset(pipes, 0, sizeof(pipes));
+    ChessEngine *ref = chess_engine_new(1);
+    bool ok = ref != NULL;
+    for (int e = 0; e < 2 && ok; ++e) {
+        ok = engine_start(&pipes[e], &m->eng[e]);
+        if (!ok) fprintf(stderr, "selfplay: cannot start %s\n", m->eng[e].path);
+    }
+    while (ok && !atomic_load(&m->abort)) {
+        int g = atomic_fetch_add(&m->next_game, 1);
+        if (g >= m->games) break;
+        const char *opening = m->openings[(g / 2) % m->n_openings];
+        int white = g & 1;
+        int result = play_game(m, pipes, ref, opening, white);
+        if (result < 0) {
+            fprintf(stderr, "selfplay: engine stopped responding in game %d\n", g + 1);
+            atomic_store(&m->abort, 1);
+            break;
+        }
+        pthread_mutex_lock(&m->lock);
+        if (result == 2) m->wins++;
+        else if (result == 1) m->draws++;
+        else m->losses++;
+        m->finished++;
+        if (m->finished % 10 == 0) report(m, false);
+        if (sprt_done(m)) atomic_store(&m->abort, 1);
+        pthread_mutex_unlock(&m->lock);
+    }
+    if (!ok) atomic_store(&m->abort, 1);
+    for (int e = 0; e < 2; ++e) pipe_close(&pipes[e]);
+    chess_engine_free(ref);
+    return NULL;
+}
+
+static int load_openings(Match *m, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    m->openings = (char (*)[128])malloc(MAX_OPENINGS * sizeof(*m->openings));
+    char line[512];
+    m->n_openings = 0;
+    while (m->openings && m->n_openings < MAX_OPENINGS && fgets(line, sizeof(line), f)) {
+        line[strcspn(line, ";\r\n")] = '\0';
+        size_t len = strlen(line);
+        while (len > 0 && line[len - 1] == ' ') line[--len] = '\0';
+        if (len == 0 || line[0] == '#' || len >= sizeof(m->openings[0])) continue;
+        memcpy(m->openings[m->n_openings++], line, len + 1);
+    }
+    fclose(f);
+    return m->n_openings;
+}
+
+static bool parse_tc(Control *tc, const char *s) {
+    double base = 0.0, inc = 0.0;
+    if (sscanf(s, "%lf+%lf", &base, &inc) < 1 || base <= 0.0) return false;
+    tc->base_ms = (int)(base * 1000.0);
+    tc->inc_ms = (int)(inc * 1000.0);
+    return true;
+}
+
+static int usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--engine1 path] [--engine2 path] [--name1 s] [--name2 s]\n"
+            "          [--opt1 Name=Value]... [--opt2 Name=Value]...\n"
+            "          [--openings file.epd] [--games N] [--concurrency N]\n"
+            "          [--nodes N | --depth N | --movetime MS | --tc base+inc]\n"
+            "          [--sprt elo0 elo1 alpha beta]\n",
+            prog);
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    static Match m;
+    memset(&m, 0, sizeof(m));
+    m.eng[0].path = m.eng[1].path = "./engine";
+    m.games = 200;
+    m.concurrency = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    m.tc.nodes = 20000;
+    const char *openings = "tests/openings.epd";
+
+    for (int i = 1; i < argc; ++i) {
+        const char *a = argv[i];
+        bool more = i + 1 < argc;
+        if (!strcmp(a, "--engine1") && more) m.eng[0].path = argv[++i];
+        else if (!strcmp(a, "--engine2") && more) m.eng[1].path = argv[++i];
+        else if (!strcmp(a, "--name1") && more) m.eng[0].name = argv[++i];
+        else if (!strcmp(a, "--name2") && more) m.eng[1].name = argv[++i];
+        else if (!strcmp(a, "--opt1") && more && m.eng[0].n_options < MAX_OPTIONS) m.eng[0].options[m.eng[0].n_options++] = argv[++i];
+        else if (!strcmp(a, "--opt2") && more && m.eng[1].n_options < MAX_OPTIONS) m.eng[1].options[m.eng[1].n_options++] = argv[++i];
+        else if (!strcmp(a, "--openings") && more) openings = argv[++i];
+        else if (!strcmp(a, "--games") && more) m.games = atoi(argv[++i]);
+        else if (!strcmp(a, "--concurrency") && more) m.concurrency = atoi(argv[++i]);
+        else if (!strcmp(a, "--nodes") && more) {
+            memset(&m.tc, 0, sizeof(m.tc));
+            m.tc.nodes = strtoull(argv[++i], NULL, 10);
+        } else if (!strcmp(a, "--depth") && more) {
+            memset(&m.tc, 0, sizeof(m.tc));
+            m.tc.depth = atoi(argv[++i]);
+        } else if (!strcmp(a, "--movetime") && more) {
+            memset(&m.tc, 0, sizeof(m.tc));
+            m.tc.movetime_ms = atoi(argv[++i]);
+        } else if (!strcmp(a, "--tc") && more) {
+            memset(&m.tc, 0, sizeof(m.tc));
+            if (!parse_tc(&m.tc, argv[++i])) return usage(argv[0]);
+        } else if (!strcmp(a, "--sprt") && i + 4 < argc) {
+            m.sprt = true;
+            m.elo0 = atof(argv[++i]);
+            m.elo1 = atof(argv[++i]);
+            m.alpha = atof(argv[++i]);
+            m.beta = atof(argv[++i]);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (!m.eng[0].name) m.eng[0].name = m.eng[0].n_options ? "engine1" : m.eng[0].path;
+    if (!m.eng[1].name) m.eng[1].name = m.eng[1].n_options ? "engine2" : m.eng[1].path;
+    if (m.games < 1 || (m.sprt && (m.alpha <= 0.0 || m.beta <= 0.0 || m.elo1 <= m.elo0))) return usage(argv[0]);
+    if (m.concurrency < 1) m.concurrency = 1;
+    if (m.concurrency > MAX_CONCURRENCY) m.concurrency = MAX_CONCURRENCY;
+    if (!load_openings(&m, openings)) {
+        fprintf(stderr, "selfplay: no openings in %s\n", openings);
+        return 2;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    pthread_mutex_init(&m.lock, NULL);
+    atomic_init(&m.next_game, 0);
+    atomic_init(&m.abort, 0);
+    printf("selfplay: %s vs %s, %d games, %d openings, concurrency %d\n",
+           m.eng[0].name, m.eng[1].name, m.games, m.n_openings, m.concurrency);
+    fflush(stdout);
+
+    pthread_t tids[MAX_CONCURRENCY];
+    int started = 0;
+    for (int t = 0; t < m.concurrency && t < m.games; ++t) {
+        if (pthread_create(&tids[t], NULL, game_worker, &m) != 0) break;
+        started++;
+    }
+    for (int t = 0; t < started; ++t) pthread_join(tids[t], NULL);
+
+    report(&m, true);
+    if (m.time_losses || m.illegal) {
+        printf("time losses %d illegal moves %d\n", m.time_losses, m.illegal);
+    }
+    pthread_mutex_destroy(&m.lock);
+    free(m.openings);
+    return m.finished ? 0 : 1;
+}
@@ -0,0 +1,641 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "init.h"
+#include "tables.h"
+
+/* Writes KQvK, KRvK, KBvK, KNvK and KPvK in the Syzygy .rtbw/.rtbz format for the tablebase suite. The
+ * tables are solved by retrograde analysis here and indexed with the published Syzygy scheme,
+ * independently of the probing code in src/tb.c. */
+
+#define N_STATES (2 * 64 * 64 * 64)
+#define INF 30000
+#define BLOCK_LOG 10
+#define SPAN_LOG 10
+#define MAX_BLOCK_VALUES 32768
+#define MAX_SYMS 1024
+#define MAX_SYM_VALUES 256
+#define MIN_PAIR_FREQ 4
+
+enum { LOSS = -2, DRAW = 0, WIN = 2 };
+enum { MOVE_QUIET, MOVE_PAWN, MOVE_PROMO_Q, MOVE_PROMO_R, MOVE_PROMO_MINOR };
+
+typedef struct {
+    const char *name;
+    int piece;
+    int8_t *wdl;
+    int16_t *dtz;
+    uint8_t *legal;
+    uint8_t *mated;
+} Material;
+
+typedef struct {
+    int child;
+    int kind;
+} WhiteMove;
+
+typedef struct {
+    uint8_t *b;
+    size_t n;
+    size_t cap;
+} Buf;
+
+typedef struct {
+    Buf head;
+    Buf sparse;
+    Buf lens;
+    Buf data;
+} Stream;
+
+static int MAP_B1H1H7[64];
+static int MAP_A1D1D4[64];
+
+static inline int state_of(int stm, int wk, int x, int bk) {
+    return ((stm * 64 + wk) * 64 + x) * 64 + bk;
+}
+
+static U64 piece_attacks(int piece, int sq, U64 occ) {
+    if (piece == WQ) return rook_attacks(sq, occ) | bishop_attacks(sq, occ);
+    if (piece == WR) return rook_attacks(sq, occ);
+    if (piece == WB) return bishop_attacks(sq, occ);
+    if (piece == WN) return KNIGHT_ATTACKS[sq];
+    return PAWN_ATTACKS[WHITE][sq];
+}
+
+static bool is_legal(const Material *m, int stm, int wk, int x, int bk) {
+    if (wk == x || wk == bk || x == bk || (KING_ATTACKS[wk] & 1ULL << bk)) return false;
+    if (m->piece == WP && (x < 8 || x > 55)) return false;
+    U64 occ = 1ULL << wk | 1ULL << x | 1ULL << bk;
+    return stm == BLACK || !(piece_attacks(m->piece, x, occ) & 1ULL << bk);
+}
+
+/* Black king moves; a child of -1 is the capture of the white piece. */
+static int black_moves(const Material *m, int wk, int x, int bk, int *child) {
+    U64 occ = 1ULL << wk | 1ULL << x;
+    U64 covered = KING_ATTACKS[wk] | 1ULL << wk | piece_attacks(m->piece, x, occ);
+    int n = 0;
+    for (U64 b = KING_ATTACKS[bk] & ~covered; b; b &= b - 1) {
+        int to = lsb_index(b);
+        child[n++] = to == x ? -1 : state_of(WHITE, wk, x, to);
+    }
+    return n;
+}
+
+static int white_moves(const Material *m, int wk, int x, int bk, WhiteMove *out) {
+    U64 occ = 1ULL << wk | 1ULL << x | 1ULL << bk;
+    int n = 0;
+    for (U64 b = KING_ATTACKS[wk] & ~(1ULL << x | 1ULL << bk | KING_ATTACKS[bk]); b; b &= b - 1) {
+        out[n++] = (WhiteMove){state_of(BLACK, lsb_index(b), x, bk), MOVE_QUIET};
+    }
+    if (m->piece != WP) {
+        for (U64 b = piece_attacks(m->piece, x, occ) & ~occ; b; b &= b - 1) {
+            out[n++] = (WhiteMove){state_of(BLACK, wk, lsb_index(b), bk), MOVE_QUIET};
+        }
+        return n;
+    }
+    int to = x + 8;
+    if (occ & 1ULL << to) return n;
+    if (to >= 56) {
+        int child = state_of(BLACK, wk, to, bk);
+        out[n++] = (WhiteMove){child, MOVE_PROMO_Q};
+        out[n++] = (WhiteMove){child, MOVE_PROMO_R};
+        out[n++] = (WhiteMove){child, MOVE_PROMO_MINOR};
+        return n;
+    }
+    out[n++] = (WhiteMove){state_of(BLACK, wk, to, bk), MOVE_PAWN};
+    if (x < 16 && !(occ & 1ULL << (x + 16))) out[n++] = (WhiteMove){state_of(BLACK, wk, x + 16, bk), MOVE_PAWN};
+    return n;
+}
+
+/* WDL of the black-to-move child of a white move, looking promotions up in the solved tables. */
+static int child_wdl(const Material *m, const Material *q, const Material *r, WhiteMove mv) {
+    switch (mv.kind) {
+        case MOVE_PROMO_Q: return q->wdl[mv.child];
+        case MOVE_PROMO_R: return r->wdl[mv.child];
+        case MOVE_PROMO_MINOR: return DRAW;
+        default: return m->wdl[mv.child];
+    }
+}
+
+static void alloc_material(Material *m, const char *name, int piece) {
+    m->name = name;
+    m->piece = piece;
+    m->wdl = (int8_t *)calloc(N_STATES, sizeof(int8_t));
+    m->dtz = (int16_t *)calloc(N_STATES, sizeof(int16_t));
+    m->legal = (uint8_t *)calloc(N_STATES, 1);
+    m->mated = (uint8_t *)calloc(N_STATES, 1);
+    if (!m->wdl || !m->dtz || !m->legal || !m->mated) {
+        fprintf(stderr, "tbgen: out of memory\n");
+        exit(1);
+    }
+}
+
+/* WDL by fixpoint iteration, then DTZ in plies: 1 for a mate or a winning pawn move, otherwise
+ * one more than the best (for white) or worst (for black) child. A mated king gets 1. */
+static void solve(Material *m, const Material *q, const Material *r) {
+    uint8_t *done = (uint8_t *)calloc(N_STATES, 1);
+    int child[8];
+    WhiteMove wm[64];
+    for (int s = 0; s < N_STATES; ++s) {
+        int stm = s >> 18, wk = (s >> 12) & 63, x = (s >> 6) & 63, bk = s & 63;
+        m->legal[s] = is_legal(m, stm, wk, x, bk);
+        if (!m->legal[s] || stm != BLACK || black_moves(m, wk, x, bk, child)) continue;
+        U64 occ = 1ULL << wk | 1ULL << x | 1ULL << bk;
+        m->mated[s] = (piece_attacks(m->piece, x, occ) & 1ULL << bk) != 0;
+        m->wdl[s] = m->mated[s] ? LOSS : DRAW;
+        done[s] = 1;
+    }
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int s = 0; s < N_STATES; ++s) {
+            if (!m->legal[s] || done[s]) continue;
+            int wk = (s >> 12) & 63, x = (s >> 6) & 63, bk = s & 63;
+            bool resolved;
+            if (s >> 18 == WHITE) {
+                int n = white_moves(m, wk, x, bk, wm);
+                resolved = false;
+                for (int i = 0; i < n && !resolved; ++i) resolved = child_wdl(m, q, r, wm[i]) == LOSS;
+            } else {
+                int n = black_moves(m, wk, x, bk, child);
+                resolved = true;
+                for (int i = 0; i < n && resolved; ++i) resolved = child[i] >= 0 && m->wdl[child[i]] == WIN;
+            }
+            if (!resolved) continue;
+            m->wdl[s] = s >> 18 == WHITE ? WIN : LOSS;
+            done[s] = 1;
+            changed = true;
+        }
+    }
+    free(done);
+
+    for (int s = 0; s < N_STATES; ++s) m->dtz[s] = m->mated[s] ? 1 : INF;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int s = 0; s < N_STATES; ++s) {
+            if (!m->legal[s] || m->wdl[s] == DRAW || m->mated[s]) continue;
+            int wk = (s >> 12) & 63, x = (s >> 6) & 63, bk = s & 63;
+            int dtz;
+            if (s >> 18 == WHITE) {
+                int n = white_moves(m, wk, x, bk, wm);
+                dtz = INF;
+                for (int i = 0; i < n; ++i) {
+                    if (child_wdl(m, q, r, wm[i]) != LOSS) continue;
+                    int d = wm[i].kind != MOVE_QUIET || m->mated[wm[i].child] ? 1 : 1 + m->dtz[wm[i].child];
+                    if (d < dtz) dtz = d;
+                }
+            } else {
+                int n = black_moves(m, wk, x, bk, child);
+                dtz = 0;
+                for (int i = 0; i < n; ++i) {
+                    if (m->dtz[child[i]] > dtz) dtz = m->dtz[child[i]];
+                }
+                dtz = dtz >= INF ? INF : dtz + 1;
+            }
+            if (dtz < m->dtz[s]) {
+                m->dtz[s] = (int16_t)dtz;
+                changed = true;
+            }
+        }
+    }
+    int wins = 0, longest = 0;
+    for (int s = 0; s < N_STATES; ++s) {
+        if (!m->legal[s] || m->wdl[s] == DRAW) continue;
+        if (m->dtz[s] >= INF || m->dtz[s] > 100) {
+            fprintf(stderr, "tbgen: %s has no short DTZ for state %d\n", m->name, s);
+            exit(1);
+        }
+        wins += s >> 18 == WHITE;
+        if (m->dtz[s] > longest) longest = m->dtz[s];
+    }
+    printf("%s: %d won positions with white to move, longest DTZ %d plies\n", m->name, wins, longest);
+}
+
+static void init_maps(void) {
+    int code = 0;
+    for (int sq = 0; sq < 64; ++sq) {
+        if ((sq >> 3) < (sq & 7)) MAP_B1H1H7[sq] = code++;
+    }
+    code = 0;
+    for (int sq = 0; sq <= 27; ++sq) {
+        if ((sq >> 3) < (sq & 7) && (sq & 7) <= 3) MAP_A1D1D4[sq] = code++;
+    }
+    for (int sq = 0; sq <= 27; sq += 9) MAP_A1D1D4[sq] = code++;
+}
+
+static inline int off_diag(int sq) { return (sq >> 3) - (sq & 7); }
+
+/* Index of [X, wK, bK] in a pawnless table with three unique pieces (31332 entries). */
+static uint64_t index_pawnless(int x, int wk, int bk) {
+    int sq[3] = {x, wk, bk};
+    if ((sq[0] & 7) > 3) for (int i = 0; i < 3; ++i) sq[i] ^= 7;
+    if ((sq[0] >> 3) > 3) for (int i = 0; i < 3; ++i) sq[i] ^= 56;
+    for (int i = 0; i < 3; ++i) {
+        if (!off_diag(sq[i])) continue;
+        if (off_diag(sq[i]) > 0) {
+            for (int j = i; j < 3; ++j) sq[j] = ((sq[j] >> 3) | (sq[j] << 3)) & 63;
+        }
+        break;
+    }
+    uint64_t a1 = sq[1] > sq[0];
+    uint64_t a2 = (uint64_t)(sq[2] > sq[0]) + (sq[2] > sq[1]);
+    uint64_t r0 = (uint64_t)(sq[0] >> 3), r1 = (uint64_t)(sq[1] >> 3), r2 = (uint64_t)(sq[2] >> 3);
+    if (off_diag(sq[0])) return ((uint64_t)MAP_A1D1D4[sq[0]] * 63 + (uint64_t)sq[1] - a1) * 62 + (uint64_t)sq[2] - a2;
+    if (off_diag(sq[1])) return (6 * 63 + r0 * 28 + (uint64_t)MAP_B1H1H7[sq[1]]) * 62 + (uint64_t)sq[2] - a2;
+    if (off_diag(sq[2])) return 6 * 63 * 62 + 4 * 28 * 62 + r0 * 7 * 28 + (r1 - a1) * 28 + (uint64_t)MAP_B1H1H7[sq[2]];
+    return 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + r0 * 7 * 6 + (r1 - a1) * 6 + (r2 - a2);
+}
+
+/* Index of [P, wK, bK] in the table of the pawn's file (a-d after mirroring, 6 * 63 * 62 entries):
+ * pawn rank, then each king square skipping the squares taken by earlier pieces. */
+static uint64_t index_pawn(int p, int wk, int bk, int *file) {
+    if ((p & 7) > 3) {
+        p ^= 7;
+        wk ^= 7;
+        bk ^= 7;
+    }
+    *file = p & 7;
+    uint64_t k1 = (uint64_t)(wk - (wk > p));
+    uint64_t k2 = (uint64_t)(bk - (bk > p) - (bk > wk));
+    return (uint64_t)((p >> 3) - 1) + 6 * (k1 + 63 * k2);
+}
+
+static void put(Buf *b, const void *p, size_t n) {
+    if (b->n + n > b->cap) {
+        b->cap = (b->n + n) * 2 + 64;
+        b->b = (uint8_t *)realloc(b->b, b->cap);
+        if (!b->b) {
+            fprintf(stderr, "tbgen: out of memory\n");
+            exit(1);
+        }
+    }
+    if (p) memcpy(b->b + b->n, p, n);
+    else memset(b->b + b->n, 0, n);
+    b->n += n;
+}
+
+static void put8(Buf *b, unsigned v) {
+    uint8_t c = (uint8_t)v;
+    put(b, &c, 1);
+}
+
+static void put16(Buf *b, unsigned v) {
+    put8(b, v & 0xFF);
+    put8(b, v >> 8);
+}
+
+static void put32(Buf *b, uint32_t v) {
+    put16(b, v & 0xFFFF);
+    put16(b, v >> 16);
+}
+
+static void align(Buf *b, size_t a) {
+    while (b->n % a) put8(b, 0);
+}
+
+/* Re-Pair: repeatedly replaces the most frequent adjacent symbol pair with a new symbol. */
+static int repair(int *seq, int n, int *left, int *right, int *len, int *n_syms) {
+    static int count[MAX_SYMS * MAX_SYMS];
+    int *touched = (int *)malloc((size_t)n * sizeof(int));
+    while (*n_syms < MAX_SYMS) {
+        int n_touched = 0, best = -1, best_count = 0;
+        for (int i = 0; i + 1 < n; ++i) {
+            int a = seq[i], b = seq[i + 1];
+            if (len[a] + len[b] > MAX_SYM_VALUES) continue;
+            int key = a * MAX_SYMS + b;
+            if (!count[key]++) touched[n_touched++] = key;
+            if (count[key] > best_count) {
+                best_count = count[key];
+                best = key;
+            }
+            if (i + 2 < n && seq[i + 2] == b && a == b) ++i;
+        }
+        for (int i = 0; i < n_touched; ++i) count[touched[i]] = 0;
+        if (best_count < MIN_PAIR_FREQ) break;
+        int a = best / MAX_SYMS, b = best % MAX_SYMS, s = (*n_syms)++;
+        left[s] = a;
+        right[s] = b;
+        len[s] = len[a] + len[b];
+        int out = 0;
+        for (int i = 0; i < n; ++i) {
+            if (i + 1 < n && seq[i] == a && seq[i + 1] == b) {
+                seq[out++] = s;
+                ++i;
+            } else {
+                seq[out++] = seq[i];
+            }
+        }
+        n = out;
+    }
+    free(touched);
+    return n;
+}
+
+/* Huffman code lengths of the symbols that occur, by repeatedly merging the two lightest nodes. */
+static void huffman_lengths(const uint64_t *freq, int n_syms, int *bits) {
+    int parent[2 * MAX_SYMS];
+    uint64_t weight[2 * MAX_SYMS];
+    bool alive[2 * MAX_SYMS];
+    int nodes = n_syms, n_alive = 0;
+    for (int s = 0; s < n_syms; ++s) {
+        weight[s] = freq[s];
+        alive[s] = freq[s] > 0;
+        n_alive += alive[s];
+        parent[s] = -1;
+        bits[s] = 0;
+    }
+    if (n_alive == 1) {
+        for (int s = 0; s < n_syms; ++s) bits[s] = freq[s] ? 1 : 0;
+        return;
+    }
+    while (n_alive > 1) {
+        int lo[2] = {-1, -1};
+        for (int i = 0; i < nodes; ++i) {
+            if (!alive[i]) continue;
+            if (lo[0] < 0 || weight[i] < weight[lo[0]]) {
+                lo[1] = lo[0];
+                lo[0] = i;
+            } else if (lo[1] < 0 || weight[i] < weight[lo[1]]) {
+                lo[1] = i;
+            }
+        }
+        alive[lo[0]] = alive[lo[1]] = false;
+        parent[lo[0]] = parent[lo[1]] = nodes;
+        weight[nodes] = weight[lo[0]] + weight[lo[1]];
+        alive[nodes] = true;
+        parent[nodes++] = -1;
+        n_alive--;
+    }
+    for (int s = 0; s < n_syms; ++s) {
+        if (!freq[s]) continue;
+        for (int p = parent[s]; p >= 0; p = parent[p]) bits[s]++;
+        if (bits[s] > 32) {
+            fprintf(stderr, "tbgen: Huffman code longer than 32 bits\n");
+            exit(1);
+        }
+    }
+}
+
+static void put_bits(uint8_t *block, int *pos, uint32_t code, int n) {
+    for (int i = n - 1; i >= 0; --i, ++*pos) {
+        if (code >> i & 1) block[*pos >> 3] |= (uint8_t)(0x80 >> (*pos & 7));
+    }
+}
+
+/* Compresses one value stream into its Huffman header, sparse index, block lengths and blocks. */
+static void compress(const int *values, int n, int flags, Stream *out) {
+    memset(out, 0, sizeof(*out));
+    bool single = true;
+    for (int i = 1; i < n && single; ++i) single = values[i] == values[0];
+    if (single) {
+        put8(&out->head, (unsigned)flags | 128);
+        put8(&out->head, (unsigned)values[0]);
+        return;
+    }
+
+    static int left[MAX_SYMS], right[MAX_SYMS], len[MAX_SYMS];
+    int leaf_of[4096];
+    int n_syms = 0;
+    int *seq = (int *)malloc((size_t)n * sizeof(int));
+    memset(leaf_of, -1, sizeof(leaf_of));
+    for (int i = 0; i < n; ++i) {
+        if (leaf_of[values[i]] < 0) {
+            leaf_of[values[i]] = n_syms;
+            left[n_syms] = values[i];
+            right[n_syms] = -1;
+            len[n_syms++] = 1;
+        }
+        seq[i] = leaf_of[values[i]];
+    }
+    int n_seq = repair(seq, n, left, right, len, &n_syms);
+
+    static uint64_t freq[MAX_SYMS];
+    static int bits[MAX_SYMS];
+    memset(freq, 0, sizeof(freq));
+    for (int i = 0; i < n_seq; ++i) freq[seq[i]]++;
+    huffman_lengths(freq, n_syms, bits);
+
+    /* Canonical code: longer codes take the lower symbol numbers and the lower code values. */
+    int min_len = 32, max_len = 1;
+    for (int s = 0; s < n_syms; ++s) {
+        if (!bits[s]) continue;
+        if (bits[s] < min_len) min_len = bits[s];
+        if (bits[s] > max_len) max_len = bits[s];
+    }
+    int order[MAX_SYMS], renum[MAX_SYMS];
+    int n_order = 0;
+    for (int l = max_len; l >= min_len; --l) {
+        for (int s = 0; s < n_syms; ++s) {
+            if (bits[s] == l) order[n_order++] = s;
+        }
+    }
+    int n_coded = n_order;
+    for (int s = 0; s < n_syms; ++s) {
+        if (!bits[s]) order[n_order++] = s;
+    }
+    for (int i = 0; i < n_syms; ++i) renum[order[i]] = i;
+
+    uint32_t code[MAX_SYMS];
+    uint32_t base = 0;
+    int first = 0;
+    for (int l = max_len; l >= min_len; --l) {
+        int count = 0;
+        while (first + count < n_coded && bits[order[first + count]] == l) {
+            code[order[first + count]] = base + (uint32_t)count;
+            count++;
+        }
+        first += count;
+        base = (base + (uint32_t)count) / 2;
+    }
+
+    Buf *h = &out->head;
+    int block_size = 1 << BLOCK_LOG;
+    uint8_t *block = (uint8_t *)calloc((size_t)block_size, 1);
+    int *block_start = (int *)malloc(((size_t)n + 1) * sizeof(int));
+    int n_blocks = 0, bit = 0, in_block = 0, value_at = 0;
+    block_start[0] = 0;
+    for (int i = 0; i < n_seq; ++i) {
+        int s = seq[i];
+        if (bit + bits[s] > block_size * 8 || in_block + len[s] > MAX_BLOCK_VALUES) {
+            put(&out->data, block, (size_t)block_size);
+            put16(&out->lens, (unsigned)(in_block - 1));
+            memset(block, 0, (size_t)block_size);
+            block_start[++n_blocks] = value_at;
+            bit = in_block = 0;
+        }
+        put_bits(block, &bit, code[s], bits[s]);
+        in_block += len[s];
+        value_at += len[s];
+    }
+    put(&out->data, block, (size_t)block_size);
+    put16(&out->lens, (unsigned)(in_block - 1));
+    block_start[++n_blocks] = value_at;
+
+    uint64_t span = 1ULL << SPAN_LOG;
+    uint64_t n_sparse = ((uint64_t)n + span - 1) / span;
+    int b = 0;
+    for (uint64_t k = 0; k < n_sparse; ++k) {
+        int target = (int)(k * span + span / 2);
+        while (b + 1 < n_blocks && block_start[b + 1] <= target) b++;
+        put32(&out->sparse, (uint32_t)b);
+        put16(&out->sparse, (unsigned)(target - block_start[b]));
+    }
+
+    put8(h, (unsigned)flags);
+    put8(h, BLOCK_LOG);
+    put8(h, SPAN_LOG);
+    put8(h, 0);
+    put32(h, (uint32_t)n_blocks);
+    put8(h, (unsigned)max_len);
+    put8(h, (unsigned)min_len);
+    for (int l = min_len; l <= max_len; ++l) {
+        int longer = 0;
+        for (int i = 0; i < n_coded; ++i) longer += bits[order[i]] > l;
+        put16(h, (unsigned)longer);
+    }
+    put16(h, (unsigned)n_syms);
+    for (int i = 0; i < n_syms; ++i) {
+        int s = order[i];
+        unsigned l = right[s] < 0 ? (unsigned)left[s] : (unsigned)renum[left[s]];
+        unsigned r = right[s] < 0 ? 0xFFF : (unsigned)renum[right[s]];
+        put8(h, l & 0xFF);
+        put8(h, (l >> 8) | (r & 0xF) << 4);
+        put8(h, r >> 4);
+    }
+    if (n_syms & 1) put8(h, 0);
+    free(block);
+    free(block_start);
+    free(seq);
+}
+
+static void fill_gaps(int *values, int n) {
+    int last = -1;
+    for (int i = 0; i < n; ++i) {
+        if (values[i] < 0) values[i] = last;
+        else last = values[i];
+    }
+    for (int i = n - 1; i >= 0 && values[i] < 0; --i) values[i] = 0;
+    for (int i = 0; i < n && values[i] < 0; ++i) values[i] = last < 0 ? 0 : last;
+}
+
+static void set_value(int *values, uint64_t idx, int v, const char *what) {
+    if (values[idx] >= 0 && values[idx] != v) {
+        fprintf(stderr, "tbgen: %s: conflicting values at index %llu\n", what, (unsigned long long)idx);
+        exit(1);
+    }
+    values[idx] = v;
+}
+
+static void write_file(const char *dir, const Material *m, bool dtz, Stream streams[4][2]) {
+    static const uint8_t WDL_MAGIC[4] = {0x71, 0xe8, 0x23, 0x5d};
+    static const uint8_t DTZ_MAGIC[4] = {0xd7, 0x66, 0x0c, 0xa5};
+    bool pawns = m->piece == WP;
+    int files = pawns ? 4 : 1;
+    int sides = dtz ? 1 : 2;
+    Buf f = {0};
+    put(&f, dtz ? DTZ_MAGIC : WDL_MAGIC, 4);
+    put8(&f, 1u | (pawns ? 2u : 0u));
+    for (int fl = 0; fl < files; ++fl) {
+        put8(&f, 0);
+        unsigned codes[3] = {(unsigned)m->piece, WK, 14};
+        for (int k = 0; k < 3; ++k) put8(&f, codes[k] | codes[k] << 4);
+    }
+    align(&f, 2);
+    for (int fl = 0; fl < files; ++fl)
+        for (int s = 0; s < sides; ++s) put(&f, streams[fl][s].head.b, streams[fl][s].head.n);
+    if (dtz) align(&f, 2);
+    for (int fl = 0; fl < files; ++fl)
+        for (int s = 0; s < sides; ++s) put(&f, streams[fl][s].sparse.b, streams[fl][s].sparse.n);
+    for (int fl = 0; fl < files; ++fl)
+        for (int s = 0; s < sides; ++s) put(&f, streams[fl][s].lens.b, streams[fl][s].lens.n);
+    for (int fl = 0; fl < files; ++fl) {
+        for (int s = 0; s < sides; ++s) {
+            if (!streams[fl][s].data.n) continue;
+            align(&f, 64);
+            put(&f, streams[fl][s].data.b, streams[fl][s].data.n);
+        }
+    }
+    put(&f, NULL, 64);
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s.%s", dir, m->name, dtz ? "rtbz" : "rtbw");
+    FILE *out = fopen(path, "wb");
+    if (!out || fwrite(f.b, 1, f.n, out) != f.n) {
+        fprintf(stderr, "tbgen: cannot write %s\n", path);
+        exit(1);
+    }
+    fclose(out);
+    printf("wrote %s (%zu bytes)\n", path, f.n);
+    free(f.b);
+    for (int fl = 0; fl < files; ++fl) {
+        for (int s = 0; s < sides; ++s) {
+            free(streams[fl][s].head.b);
+            free(streams[fl][s].sparse.b);
+            free(streams[fl][s].lens.b);
+            free(streams[fl][s].data.b);
+        }
+    }
+}
+
+/* WDL stores both sides to move as wdl + 2; DTZ stores white to move only, as plies - 1. */
+static void write_tables(const char *dir, const Material *m) {
+    bool pawns = m->piece == WP;
+    int files = pawns ? 4 : 1;
+    int size = pawns ? 6 * 63 * 62 : 31332;
+    int *wdl[4][2], *dtz[4];
+    for (int fl = 0; fl < files; ++fl) {
+        wdl[fl][0] = (int *)malloc((size_t)size * sizeof(int));
+        wdl[fl][1] = (int *)malloc((size_t)size * sizeof(int));
+        dtz[fl] = (int *)malloc((size_t)size * sizeof(int));
+        for (int i = 0; i < size; ++i) wdl[fl][0][i] = wdl[fl][1][i] = dtz[fl][i] = -1;
+    }
+    for (int s = 0; s < N_STATES; ++s) {
+        if (!m->legal[s]) continue;
+        int stm = s >> 18, wk = (s >> 12) & 63, x = (s >> 6) & 63, bk = s & 63;
+        int fl = 0;
+        uint64_t idx = pawns ? index_pawn(x, wk, bk, &fl) : index_pawnless(x, wk, bk);
+        set_value(wdl[fl][stm], idx, m->wdl[s] + 2, m->name);
+        if (stm == WHITE && m->wdl[s] == WIN) set_value(dtz[fl], idx, m->dtz[s] - 1, m->name);
+    }
+    Stream streams[4][2];
+    for (int fl = 0; fl < files; ++fl) {
+        for (int stm = 0; stm < 2; ++stm) {
+            fill_gaps(wdl[fl][stm], size);
+            compress(wdl[fl][stm], size, 0, &streams[fl][stm]);
+        }
+    }
+    write_file(dir, m, false, streams);
+    for (int fl = 0; fl < files; ++fl) {
+        fill_gaps(dtz[fl], size);
+        compress(dtz[fl], size, 4 | 8, &streams[fl][0]);
+    }
+    write_file(dir, m, true, streams);
+    for (int fl = 0; fl < files; ++fl) {
+        free(wdl[fl][0]);
+        free(wdl[fl][1]);
+        free(dtz[fl]);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *dir = argc > 1 ? argv[1] : "tests/syzygy";
+    engine_init();
+    init_maps();
+    Material kq, kr, kb, kn, kp;
+    alloc_material(&kq, "KQvK", WQ);
+    alloc_material(&kr, "KRvK", WR);
+    alloc_material(&kb, "KBvK", WB);
+    alloc_material(&kn, "KNvK", WN);
+    alloc_material(&kp, "KPvK", WP);
+    solve(&kq, NULL, NULL);
+    solve(&kr, NULL, NULL);
+    solve(&kb, NULL, NULL);
+    solve(&kn, NULL, NULL);
+    solve(&kp, &kq, &kr);
+    write_tables(dir, &kq);
+    write_tables(dir, &kr);
+    write_tables(dir, &kb);
+    write_tables(dir, &kn);
+    write_tables(dir, &kp);
+    return 0;
+}
@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+#include "move.h"
+
+#define HIST_DEPTHS 64
+#define HIST_PLIES 128
+#define CHUNK 4096
+
+static const char *PRUNE_NAMES[PRUNE_COUNT] = {
+    "none", "tt", "mate_distance", "stand_pat", "max_ply", "stopped", "no_moves", "endgame", "tablebase",
+    "futility"
+};
+
+typedef struct {
+    uint64_t nodes;
+    uint64_t tt_hits;
+    uint64_t tt_cuts;
+    uint64_t beta_cuts;
+} Bucket;
+
+typedef struct {
+    int search_id;
+    int iter;
+    int max_ply;
+    int prune;
+    uint32_t root_from;
+    uint32_t root_to;
+    bool has_root;
+} Filter;
+
+static void move_str(uint32_t mv, char *out) {
+    if (!mv) {
+        strcpy(out, "0000");
+        return;
+    }
+    int from = M_FROM(mv);
+    int to = M_TO(mv);
+    out[0] = (char)('a' + (from & 7));
+    out[1] = (char)('1' + (from >> 3));
+    out[2] = (char)('a' + (to & 7));
+    out[3] = (char)('1' + (to >> 3));
+    out[4] = '\0';
+    if (M_FLAGS(mv) & FLAG_PROMO) {
+        static const char promo[13] = ".pnbrqkpnbrqk";
+        out[4] = promo[M_PROMO(mv)];
+        out[5] = '\0';
+    }
+}
+
+static bool parse_square(const char *s, uint32_t *sq) {
+    if (s[0] < 'a' || s[0] > 'h' || s[1] < '1' || s[1] > '8') return false;
+    *sq = (uint32_t)((s[1] - '1') * 8 + (s[0] - 'a'));
+    return true;
+}
+
+static FILE *open_trace(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "traceview: cannot open %s\n", path);
+        return NULL;
+    }
+    TraceHeader h;
+    if (fread(&h, sizeof(h), 1, f) != 1 || h.magic != TRACE_MAGIC
+        || h.record_size != sizeof(TraceRecord)) {
+        fprintf(stderr, "traceview: %s is not a version %d trace\n", path, TRACE_VERSION);
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+static void add(Bucket *b, const TraceRecord *r) {
+    b->nodes++;
+    if (r->flags & TRACE_TT_HIT) b->tt_hits++;
+    if (r->flags & TRACE_TT_CUT) b->tt_cuts++;
+    if (r->flags & TRACE_BETA_CUT) b->beta_cuts++;
+}
+
+static double pct(uint64_t num, uint64_t den) {
+    return den ? 100.0 * (double)num / (double)den : 0.0;
+}
+
+static void print_bucket(const char *label, int key, const Bucket *b) {
+    printf("%-6s %4d %12llu %7.1f%% %7.1f%% %7.1f%%\n", label, key,
+           (unsigned long long)b->nodes, pct(b->tt_hits, b->nodes),
+           pct(b->tt_cuts, b->nodes), pct(b->beta_cuts, b->nodes));
+}
+
+static int summarize(const char *path) {
+    FILE *f = open_trace(path);
+    if (!f) return 2;
+    static Bucket by_depth[HIST_DEPTHS];
+    static Bucket by_ply[HIST_PLIES];
+    Bucket qs = {0, 0, 0, 0};
+    uint64_t prunes[PRUNE_COUNT] = {0};
+    uint64_t total = 0;
+    int searches = 0;
+    int last_search = -1;
+    TraceRecord buf[CHUNK];
+    size_t n;
+    while ((n = fread(buf, sizeof(TraceRecord), CHUNK, f)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            const TraceRecord *r = &buf[i];
+            total++;
+            if (r->search_id != last_search) {
+                last_search = r->search_id;
+                searches++;
+            }
+            if (r->flags & TRACE_QSEARCH) add(&qs, r);
+            else if (r->depth >= 0 && r->depth < HIST_DEPTHS) add(&by_depth[r->depth], r);
+            if (r->ply < HIST_PLIES) add(&by_ply[r->ply], r);
+            if (r->prune < PRUNE_COUNT) prunes[r->prune]++;
+        }
+    }
+    fclose(f);
+
+    printf("records %llu searches %d qsearch %.1f%%\n", (unsigned long long)total, searches,
+           pct(qs.nodes, total));
+    printf("%-6s %4s %12s %8s %8s %8s\n", "", "", "nodes", "tt_hit", "tt_cut", "beta_cut");
+    for (int d = HIST_DEPTHS - 1; d >= 1; --d) {
+        if (by_depth[d].nodes) print_bucket("depth", d, &by_depth[d]);
+    }
+    if (qs.nodes) print_bucket("qs", 0, &qs);
+    for (int p = 0; p < HIST_PLIES; ++p) {
+        if (by_ply[p].nodes) print_bucket("ply", p, &by_ply[p]);
+    }
+    for (int i = 0; i < PRUNE_COUNT; ++i) {
+        printf("prune %-14s %12llu\n", PRUNE_NAMES[i], (unsigned long long)prunes[i]);
+    }
+    return 0;
+}
+
+static void print_record(const TraceRecord *r) {
+    char mv[6], best[6];
+    move_str(r->move, mv);
+    move_str(r->best, best);
+    printf("%u %u %2u %*s%-5s d=%-3d [%d,%d] %d best=%s%s%s%s%s%s%s%s\n",
+           r->search_id, r->root_depth, r->ply, r->ply, "", mv, r->depth,
+           r->alpha, r->beta, r->score, best,
+           (r->flags & TRACE_QSEARCH) ? " qs" : "",
+           (r->flags & TRACE_IN_CHECK) ? " check" : "",
+           (r->flags & TRACE_TT_HIT) ? " tthit" : "",
+           (r->flags & TRACE_TT_CUT) ? " ttcut" : "",
+           (r->flags & TRACE_BETA_CUT) ? " betacut" : "",
+           r->prune ? " prune=" : "",
+           r->prune && r->prune < PRUNE_COUNT ? PRUNE_NAMES[r->prune] : "");
+}
+
+static bool keep(const Filter *flt, const TraceRecord *r) {
+    if (flt->search_id >= 0 && r->search_id != flt->search_id) return false;
+    if (flt->iter >= 0 && r->root_depth != flt->iter) return false;
+    if (flt->max_ply >= 0 && r->ply > flt->max_ply) return false;
+    if (flt->prune >= 0 && r->prune != flt->prune) return false;
+    return true;
+}
+
+static int dump(const char *path, const Filter *flt) {
+    FILE *f = open_trace(path);
+    if (!f) return 2;
+    size_t cap = 1 << 16;
+    size_t pending = 0;
+    TraceRecord *sub = flt->has_root ? (TraceRecord *)malloc(cap * sizeof(TraceRecord)) : NULL;
+    if (flt->has_root && !sub) {
+        fclose(f);
+        return 2;
+    }
+    TraceRecord buf[CHUNK];
+    size_t n;
+    while ((n = fread(buf, sizeof(TraceRecord), CHUNK, f)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            const TraceRecord *r = &buf[i];
+            if (!flt->has_root) {
+                if (keep(flt, r)) print_record(r);
+                continue;
+            }
+            if (r->ply >= 2) {
+                if (pending == cap) {
+                    TraceRecord *grown = (TraceRecord *)realloc(sub, 2 * cap * sizeof(TraceRecord));
+                    if (!grown) break;
+                    sub = grown;
+                    cap *= 2;
+                }
+                sub[pending++] = *r;
+                continue;
+            }
+            if (r->ply == 1 && (uint32_t)M_FROM(r->move) == flt->root_from
+                && (uint32_t)M_TO(r->move) == flt->root_to) {
+                for (size_t k = 0; k < pending; ++k) {
+                    if (keep(flt, &sub[k])) print_record(&sub[k]);
+                }
+                if (keep(flt, r)) print_record(r);
+            }
+            pending = 0;
+        }
+    }
+    free(sub);
+    fclose(f);
+    return 0;
+}
+
+static int usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s summary <trace>\n"
+            "       %s dump <trace> [--search N] [--iter D] [--root e2e4] [--max-ply P] [--prune NAME]\n",
+            prog, prog);
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) return usage(argv[0]);
+    if (!strcmp(argv[1], "summary")) return summarize(argv[2]);
+    if (strcmp(argv[1], "dump")) return usage(argv[0]);
+
+    Filter flt = {-1, -1, -1, -1, 0, 0, false};
+    for (int i = 3; i + 1 < argc; i += 2) {
+        const char *opt = argv[i];
+        const char *val = argv[i + 1];
+        if (!strcmp(opt, "--search")) {
+            flt.search_id = atoi(val);
+        } else if (!strcmp(opt, "--iter")) {
+            flt.iter = atoi(val);
+        } else if (!strcmp(opt, "--max-ply")) {
+            flt.max_ply = atoi(val);
+        } else if (!strcmp(opt, "--root")) {
+            if (strlen(val) < 4 || !parse_square(val, &flt.root_from)
+                || !parse_square(val + 2, &flt.root_to)) {
+                return usage(argv[0]);
+            }
+            flt.has_root = true;
+        } else if (!strcmp(opt, "--prune")) {
+            for (int k = 0; k < PRUNE_COUNT; ++k) {
+                if (!strcmp(val, PRUNE_NAMES[k])) flt.prune = k;
+            }
+            if (flt.prune < 0) return usage(argv[0]);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    return dump(argv[2], &flt);
+}